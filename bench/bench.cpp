@@ -0,0 +1,190 @@
+#include "../src/multilevel.h"
+#include "../src/partitioner.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <vector>
+using namespace std;
+
+// Benchmark harness: partitions one input and prints a single JSON line
+// with the wall time of every phase (parse, initial partition, each FM
+// pass, output), the cutsize and the peak RSS of the process. Run one
+// input per process so that the peak RSS belongs to that input.
+
+typedef chrono::steady_clock Clock;
+
+static double seconds(const Clock::time_point &start, const Clock::time_point &end)
+{
+    return chrono::duration<double>(end - start).count();
+}
+
+static void usage()
+{
+    cerr << "Usage: ./fm-bench [options] <input file>" << endl
+         << "Options:" << endl
+         << "  --multilevel   use the multilevel V-cycle instead of flat FM" << endl
+         << "  --refiner=R    fm (sequential FM passes, default), lp or lp+fm (parallel label propagation)" << endl
+         << "  --threads=N    threads of the label propagation and count sweeps (default: 1)" << endl
+         << "  --seed=N       seed of the multilevel matching (default: 0)" << endl
+         << "  --stop-after=K end an FM pass after K moves without a new max partial sum" << endl
+         << "  --stop-drop=D  end an FM pass once the partial sum falls D below its max" << endl
+         << "  --output=FILE  write the partition to FILE (default: /dev/null)" << endl
+         << "  --label=NAME   label of the run in the report (default: the input file)" << endl;
+    exit(1);
+}
+
+// quote a string for JSON
+static string quote(const char *str)
+{
+    string quoted = "\"";
+    for (const char *p = str; *p != '\0'; p++)
+    {
+        if (*p == '"' || *p == '\\')
+            quoted += '\\';
+        quoted += *p;
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char **argv)
+{
+    bool multilevel = false;
+    const char *refinerName = "fm";
+    Partitioner::Refiner refiner = Partitioner::FM_PASSES;
+    int threadNum = 1;
+    unsigned seed = 0;
+    int stallLimit = 0;
+    int dropLimit = 0;
+    const char *outName = "/dev/null";
+    const char *label = NULL;
+    const char *inName = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--multilevel") == 0)
+            multilevel = true;
+        else if (strncmp(argv[i], "--refiner=", 10) == 0)
+        {
+            refinerName = argv[i] + 10;
+            if (!Partitioner::findRefiner(refinerName, refiner))
+                usage();
+        }
+        else if (strncmp(argv[i], "--threads=", 10) == 0)
+            threadNum = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+            seed = strtoul(argv[i] + 7, NULL, 10);
+        else if (strncmp(argv[i], "--stop-after=", 13) == 0)
+            stallLimit = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "--stop-drop=", 12) == 0)
+            dropLimit = atoi(argv[i] + 12);
+        else if (strncmp(argv[i], "--output=", 9) == 0)
+            outName = argv[i] + 9;
+        else if (strncmp(argv[i], "--label=", 8) == 0)
+            label = argv[i] + 8;
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            cerr << "Unknown option \"" << argv[i] << "\"." << endl;
+            usage();
+        }
+        else if (inName == NULL)
+            inName = argv[i];
+        else
+            usage();
+    }
+    if (inName == NULL)
+        usage();
+
+    // parse
+    Partitioner partitioner;
+    Clock::time_point start = Clock::now();
+    if (!partitioner.parseFile(inName))
+    {
+        cerr << "Cannot open the input file \"" << inName << "\"." << endl;
+        exit(1);
+    }
+    Clock::time_point end = Clock::now();
+    const double parseTime = seconds(start, end);
+    partitioner.setVerbose(false);
+    partitioner.setStallLimit(stallLimit);
+    partitioner.setDropLimit(dropLimit);
+    partitioner.setRefiner(refiner);
+    partitioner.setThreadNum(threadNum);
+
+    // time each FM pass of the finest level, pass 0 is the gain initialization
+    vector<double> passTime;
+    vector<int> passCut;
+    vector<int> passMove;
+    Clock::time_point refineStart, passStart;
+    partitioner.setPassCallback([&](int pass) {
+        Clock::time_point now = Clock::now();
+        if (pass == 0)
+            refineStart = now;
+        else
+        {
+            passTime.push_back(seconds(passStart, now));
+            passCut.push_back(partitioner.getCutSize());
+            passMove.push_back(partitioner.getMoveNum());
+        }
+        passStart = now;
+    });
+
+    // everything up to the counted initial gains of the finest level is the
+    // initial partition, for multilevel also coarsening and the coarse levels
+    start = Clock::now();
+    if (multilevel)
+    {
+        Multilevel ml(partitioner);
+        ml.setSeed(seed);
+        ml.setVerbose(false);
+        ml.partition();
+    }
+    else
+        partitioner.partition();
+    end = Clock::now();
+    const double initTime = seconds(start, refineStart);
+    const double refineTime = seconds(refineStart, end);
+
+    // output
+    start = Clock::now();
+    fstream outFile(outName, ios::out);
+    if (!outFile)
+    {
+        cerr << "Cannot open the output file \"" << outName << "\"." << endl;
+        exit(1);
+    }
+    partitioner.writeResult(outFile);
+    outFile.close();
+    end = Clock::now();
+    const double outputTime = seconds(start, end);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    ostringstream json;
+    json << "{\"label\":" << quote(label != NULL ? label : inName)
+         << ",\"mode\":\"" << (multilevel ? "multilevel" : "flat") << "\""
+         << ",\"refiner\":" << quote(refinerName) << ",\"threads\":" << threadNum
+         << ",\"cells\":" << partitioner.getCellNum()
+         << ",\"nets\":" << partitioner.getNetNum()
+         << ",\"pins\":" << partitioner.getPinNum()
+         << ",\"cutsize\":" << partitioner.getCutSize()
+         << ",\"time\":{\"parse\":" << parseTime
+         << ",\"initial\":" << initTime
+         << ",\"refine\":" << refineTime
+         << ",\"output\":" << outputTime
+         << ",\"total\":" << parseTime + initTime + refineTime + outputTime << "}"
+         << ",\"passes\":[";
+    for (size_t i = 0; i < passTime.size(); i++)
+    {
+        json << (i > 0 ? "," : "") << "{\"time\":" << passTime[i] << ",\"cutsize\":" << passCut[i]
+             << ",\"moves\":" << passMove[i] << "}";
+    }
+    json << "],\"memory_bytes\":" << partitioner.countMemoryUsage().getTotal() << ",\"peak_rss_kb\":" << usage.ru_maxrss
+         << "}";
+    cout << json.str() << endl;
+    return 0;
+}
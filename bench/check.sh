@@ -0,0 +1,103 @@
+#!/bin/sh
+# Consistency check: run the bundled inputs through every mode and score
+# each result with --evaluate. The cutsize a result reports must be the
+# one --evaluate recounts, and the partition must be balanced. Prints one
+# line per run and exits nonzero if any run fails.
+#
+#   CHECK_INPUTS  netlists to run (default: input_pa1/input_*.dat)
+ROOT=$(dirname "$0")/..
+FM="$ROOT/bin/fm"
+INPUTS=${CHECK_INPUTS:-$(ls "$ROOT"/input_pa1/input_*.dat)}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+failNum=0
+runNum=0
+
+fail()
+{
+    echo "FAIL $1: $2"
+    failNum=$((failNum + 1))
+}
+
+# evaluate <name> <input> <result>
+evaluate()
+{
+    reported=$(sed -n 's/^Cutsize = //p' "$3")
+    line=$("$FM" --evaluate "$2" "$3" 2>&1 | head -n 1)
+    case "$line" in
+    *": cutsize $reported, part sizes "*", balanced") echo "ok   $1" ;;
+    *) fail "$1" "reports cutsize $reported; $line" ;;
+    esac
+}
+
+# run <name> <input> [options]: partition input into $DIR/<name>.out
+run()
+{
+    name=$1
+    input=$2
+    shift 2
+    runNum=$((runNum + 1))
+    if ! "$FM" "$@" "$input" "$DIR/$name.out" > "$DIR/$name.log" 2>&1; then
+        fail "$name" "exit $? ($(tail -n 1 "$DIR/$name.log"))"
+        return 1
+    fi
+    return 0
+}
+
+# cells of a netlist, or of the "G<i> <n>" / "<cells> ;" lines of a result
+netlistCells()
+{
+    awk '$1 == "NET" { for (i = 3; i <= NF && $i != ";"; i++) print $i }' "$1" | sort -u
+}
+resultCells()
+{
+    awk 'NR > 1 && NR % 2 == 1 { for (i = 1; i <= NF && $i != ";"; i++) print $i }' "$1" | sort
+}
+
+for input in $INPUTS; do
+    base=$(basename "$input" .dat)
+    netlistCells "$input" > "$DIR/$base.cells"
+
+    run "$base-fm" "$input" && evaluate "$base-fm" "$input" "$DIR/$base-fm.out"
+    run "$base-multilevel" "$input" --multilevel && evaluate "$base-multilevel" "$input" "$DIR/$base-multilevel.out"
+    run "$base-multistart" "$input" --starts=4 --threads=2 &&
+        evaluate "$base-multistart" "$input" "$DIR/$base-multistart.out"
+    run "$base-reorder" "$input" --reorder && evaluate "$base-reorder" "$input" "$DIR/$base-reorder.out"
+    run "$base-compact" "$input" --compact && evaluate "$base-compact" "$input" "$DIR/$base-compact.out"
+    for refiner in lp lp+fm; do
+        run "$base-$refiner" "$input" --refiner=$refiner --threads=2 &&
+            evaluate "$base-$refiner" "$input" "$DIR/$base-$refiner.out"
+    done
+
+    # the first run writes the cache, the second loads it
+    for pass in write load; do
+        run "$base-cache-$pass" "$input" --cache="$DIR/$base.fmb" &&
+            evaluate "$base-cache-$pass" "$input" "$DIR/$base-cache-$pass.out"
+    done
+
+    # a 2-way k-way run can be evaluated; a 4-way one must keep every cell once
+    run "$base-kway2" "$input" --kway=2 && evaluate "$base-kway2" "$input" "$DIR/$base-kway2.out"
+    if run "$base-kway4" "$input" --kway=4; then
+        resultCells "$DIR/$base-kway4.out" > "$DIR/$base-kway4.cells"
+        if [ "$(grep -c '^G' "$DIR/$base-kway4.out")" -ne 4 ]; then
+            fail "$base-kway4" "not 4 blocks"
+        elif ! cmp -s "$DIR/$base.cells" "$DIR/$base-kway4.cells"; then
+            fail "$base-kway4" "cells missing or repeated"
+        else
+            echo "ok   $base-kway4"
+        fi
+    fi
+
+    # ECO: drop a fifth of G1 from the netlist, which leaves the earlier
+    # result out of balance, and repartition from it
+    if [ -f "$DIR/$base-fm.out" ]; then
+        awk 'NR == FNR { if (FNR == 2) n = int($2 / 5); if (FNR == 3) for (i = 1; i <= n; i++) drop[$i] = 1; next }
+             { line = ""; for (i = 1; i <= NF; i++) if (!($i in drop)) line = line (line == "" ? "" : " ") $i; print line }' \
+            "$DIR/$base-fm.out" "$input" > "$DIR/$base-edit.dat"
+        run "$base-eco" "$DIR/$base-edit.dat" --eco="$DIR/$base-fm.out" --eco-netlist="$input" &&
+            evaluate "$base-eco" "$DIR/$base-edit.dat" "$DIR/$base-eco.out"
+    fi
+done
+
+echo "$((runNum - failNum)) of $runNum runs passed"
+[ "$failNum" -eq 0 ]
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+using namespace std;
+
+// Synthetic netlist generator writing the .dat format read by fm.
+//
+// Nets are added until the pin target is reached. The size of each net is
+// drawn from [minSize, maxSize], uniformly or from a power law
+// P(s) ~ s^-alpha (real netlists are dominated by small nets with a long
+// tail). With locality W the pins of a net are picked within W cells of a
+// random anchor cell, which gives the circuit a cut structure that
+// partitioners can find; W = 0 picks pins anywhere (a random hypergraph).
+
+static void usage()
+{
+    cerr << "Usage: ./gen [options] <output file>" << endl
+         << "Options:" << endl
+         << "  --cells=N          number of cells (default: 10000)" << endl
+         << "  --pins=N           number of pins to generate (default: 4 * cells)" << endl
+         << "  --net-size=MIN:MAX range of net sizes (default: 2:30)" << endl
+         << "  --dist=D           net size distribution, uniform or powerlaw (default: powerlaw)" << endl
+         << "  --alpha=A          exponent of the power law (default: 2.5)" << endl
+         << "  --locality=W       pick the pins of a net within W cells of an anchor, 0: anywhere" << endl
+         << "                     (default: 1000)" << endl
+         << "  --balance=B        balance factor written to the file (default: 0.1)" << endl
+         << "  --max-area=A       write CELL areas drawn from [1, A] (default: 1, no areas)" << endl
+         << "  --max-weight=W     write NETWEIGHT weights drawn from [1, W] (default: 1, no weights)" << endl
+         << "  --seed=N           random seed (default: 0)" << endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    int cellNum = 10000;
+    long long pinNum = -1;
+    int minSize = 2;
+    int maxSize = 30;
+    bool powerLaw = true;
+    double alpha = 2.5;
+    int locality = 1000;
+    double bFactor = 0.1;
+    int maxArea = 1;
+    int maxWeight = 1;
+    unsigned seed = 0;
+    const char *fileName = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--cells=", 8) == 0)
+            cellNum = atoi(argv[i] + 8);
+        else if (strncmp(argv[i], "--pins=", 7) == 0)
+            pinNum = atoll(argv[i] + 7);
+        else if (strncmp(argv[i], "--net-size=", 11) == 0)
+        {
+            if (sscanf(argv[i] + 11, "%d:%d", &minSize, &maxSize) != 2)
+                usage();
+        }
+        else if (strcmp(argv[i], "--dist=uniform") == 0)
+            powerLaw = false;
+        else if (strcmp(argv[i], "--dist=powerlaw") == 0)
+            powerLaw = true;
+        else if (strncmp(argv[i], "--alpha=", 8) == 0)
+            alpha = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--locality=", 11) == 0)
+            locality = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--balance=", 10) == 0)
+            bFactor = atof(argv[i] + 10);
+        else if (strncmp(argv[i], "--max-area=", 11) == 0)
+            maxArea = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--max-weight=", 13) == 0)
+            maxWeight = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+            seed = strtoul(argv[i] + 7, NULL, 10);
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            cerr << "Unknown option \"" << argv[i] << "\"." << endl;
+            usage();
+        }
+        else if (fileName == NULL)
+            fileName = argv[i];
+        else
+            usage();
+    }
+    if (fileName == NULL)
+        usage();
+    if (pinNum < 0)
+        pinNum = 4LL * cellNum;
+    maxSize = min(maxSize, cellNum);
+    if (cellNum < 2 || minSize < 2 || minSize > maxSize)
+    {
+        cerr << "Need at least 2 cells and 2 <= MIN <= MAX <= cells." << endl;
+        usage();
+    }
+    if (locality > 0)
+        locality = max(locality, maxSize);
+
+    FILE *out = fopen(fileName, "w");
+    if (out == NULL)
+    {
+        cerr << "Cannot open the output file \"" << fileName << "\"." << endl;
+        exit(1);
+    }
+    static char buffer[1 << 20];
+    setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    mt19937 rng(seed);
+    vector<double> sizeWeight;
+    for (int s = minSize; s <= maxSize; s++)
+    {
+        sizeWeight.push_back(powerLaw ? pow((double)s, -alpha) : 1.0);
+    }
+    discrete_distribution<int> sizeDist(sizeWeight.begin(), sizeWeight.end());
+    uniform_int_distribution<int> cellDist(0, cellNum - 1);
+
+    fprintf(out, "%g\n", bFactor);
+    vector<int> pins;
+    long long netNum = 0;
+    for (long long pinCount = 0; pinCount < pinNum; netNum++)
+    {
+        const int size = minSize + sizeDist(rng);
+        const int anchor = cellDist(rng);
+        pins.clear();
+        while ((int)pins.size() < size)
+        {
+            int cell = cellDist(rng);
+            if (locality > 0)
+            {
+                uniform_int_distribution<int> offsetDist(-locality, locality);
+                cell = (anchor + offsetDist(rng) + cellNum) % cellNum;
+            }
+            if (find(pins.begin(), pins.end(), cell) == pins.end())
+                pins.push_back(cell);
+        }
+
+        fprintf(out, "NET n%lld", netNum);
+        for (size_t i = 0; i < pins.size(); i++)
+        {
+            fprintf(out, " c%d", pins[i]);
+        }
+        fprintf(out, " ;\n");
+        pinCount += size;
+    }
+
+    if (maxArea > 1)
+    {
+        uniform_int_distribution<int> areaDist(1, maxArea);
+        for (int i = 0; i < cellNum; i++)
+        {
+            fprintf(out, "CELL c%d %d\n", i, areaDist(rng));
+        }
+    }
+    if (maxWeight > 1)
+    {
+        uniform_int_distribution<int> weightDist(1, maxWeight);
+        for (long long i = 0; i < netNum; i++)
+        {
+            fprintf(out, "NETWEIGHT n%lld %d\n", i, weightDist(rng));
+        }
+    }
+    fclose(out);
+    return 0;
+}
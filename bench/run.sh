@@ -0,0 +1,35 @@
+#!/bin/sh
+# Size sweep: generate one synthetic netlist per pin count and run the
+# harness on it in every mode, one JSON line per run on stdout.
+#
+#   BENCH_SIZES  pin counts to sweep (default: 1e4 to 1e7)
+#   BENCH_MODES  harness modes, "flat" and/or "multilevel" (default: both)
+#   BENCH_REFINERS  refiners per mode, "fm", "lp" and/or "lp+fm" (default: all)
+#   BENCH_THREADS   threads of the label propagation runs (default: all cores)
+#   BENCH_DIR    where the generated netlists are kept (default: /tmp/fm-bench)
+#   GEN_FLAGS    extra generator options, e.g. "--dist=uniform --locality=0"
+set -e
+
+BIN=$(dirname "$0")/../bin
+SIZES=${BENCH_SIZES:-"10000 100000 1000000 10000000"}
+MODES=${BENCH_MODES:-"flat multilevel"}
+REFINERS=${BENCH_REFINERS:-"fm lp lp+fm"}
+THREADS=${BENCH_THREADS:-$(nproc)}
+DIR=${BENCH_DIR:-/tmp/fm-bench}
+mkdir -p "$DIR"
+
+for pins in $SIZES; do
+    file="$DIR/synth_$pins.dat"
+    if [ ! -f "$file" ]; then
+        "$BIN/gen" --cells=$((pins / 4)) --pins=$pins $GEN_FLAGS "$file"
+    fi
+    for mode in $MODES; do
+        flag=""
+        [ "$mode" = multilevel ] && flag="--multilevel"
+        for refiner in $REFINERS; do
+            threads=1
+            [ "$refiner" != fm ] && threads=$THREADS
+            "$BIN/fm-bench" $flag --refiner=$refiner --threads=$threads --label="synth_$pins" "$file"
+        done
+    done
+done
@@ -0,0 +1,93 @@
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+// Section-wise binary file IO for the cached hypergraph format. Every
+// section starts at a multiple of 8 bytes and is zero padded to one, so
+// the payload can be mapped and read in place as int arrays, and the
+// checksum can run over whole 64-bit words.
+
+// FNV-1a over 64-bit words, the last partial word zero extended
+static inline uint64_t checksumWords(uint64_t h, const char *data, const size_t size)
+{
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 1099511628211ULL;
+    }
+    if (i < size)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        h = (h ^ word) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static const uint64_t CHECKSUM_SEED = 14695981039346656037ULL;
+
+// Writes padded sections to a file, keeping the checksum of all of them
+class BinaryWriter
+{
+public:
+    // constructor and destructor
+    BinaryWriter(FILE *file) : _file(file), _size(0), _checksum(CHECKSUM_SEED), _ok(file != NULL) {}
+    ~BinaryWriter() {}
+
+    // basic access methods
+    uint64_t getSize() const { return _size; }
+    uint64_t getChecksum() const { return _checksum; }
+    bool isOk() const { return _ok; }
+
+    // modify methods
+    void write(const void *data, const size_t size)
+    {
+        static const char zero[8] = {0};
+        const size_t pad = (8 - size % 8) % 8;
+        _ok = _ok && fwrite(data, 1, size, _file) == size && fwrite(zero, 1, pad, _file) == pad;
+        _checksum = checksumWords(_checksum, (const char *)data, size);
+        _size += size + pad;
+    }
+
+private:
+    FILE *_file;        // output, positioned after the header
+    uint64_t _size;     // bytes written including padding
+    uint64_t _checksum; // checksum of the written sections
+    bool _ok;           // no write failed so far
+};
+
+// Hands out padded sections of a mapped payload in place
+class BinaryReader
+{
+public:
+    // constructor and destructor
+    BinaryReader(const char *data, const size_t size) : _data(data), _size(size), _pos(0) {}
+    ~BinaryReader() {}
+
+    // basic access methods
+    bool atEnd() const { return _pos == _size; }
+
+    // next section of size bytes, NULL if the payload is too short
+    const void *read(const size_t size)
+    {
+        const size_t padded = size + (8 - size % 8) % 8;
+        if (padded > _size - _pos)
+            return NULL;
+        const void *section = _data + _pos;
+        _pos += padded;
+        return section;
+    }
+
+private:
+    const char *_data; // start of the payload, 8-byte aligned
+    size_t _size;      // payload length
+    size_t _pos;       // start of the next section
+};
+
+#endif // BINARYIO_H
@@ -0,0 +1,204 @@
+#ifndef BUCKET_H
+#define BUCKET_H
+
+#include "cell.h"
+#include "stats.h"
+#include <map>
+#include <vector>
+using namespace std;
+
+// Array of doubly-linked lists indexed by gain, one list per gain value.
+// Nodes are linked in place through their prev/next pointers, so insert,
+// remove and gain change are O(1). Non-empty buckets are tracked in a
+// two-level bitmap, so finding the max gain bucket skips 4096 empty
+// buckets per summary bit even when weighted gains spread out.
+//
+// When the gain range is much larger than the number of nodes (large net
+// weights), a dense array would cost memory per possible gain value, so
+// the heads are kept in an ordered map of the non-empty gains instead;
+// the max gain is still read in O(1) from its end.
+class BucketList
+{
+public:
+    // constructor and destructor
+    BucketList() : _maxGain(0), _maxIdx(-1), _size(0), _sparse(false), _scanNum(0) {}
+    ~BucketList() {}
+
+    // basic access methods
+    int getMaxGain() const { return _maxGain; }
+    int getSize() const { return _size; }
+    bool empty() const { return _size == 0; }
+    bool isSparse() const { return _sparse; }
+    long long getScanNum() const { return _scanNum; } // bitmap words read, 0 with FM_NO_STATS
+    size_t getMemoryUsage() const // heap bytes, map nodes estimated at three pointers of overhead
+    {
+        return sizeof(Node *) * _bucket.capacity() +
+               sizeof(unsigned long long) * (_bits.capacity() + _summary.capacity()) +
+               (sizeof(pair<const int, Node *>) + 3 * sizeof(void *) + sizeof(int)) * _sparseBucket.size();
+    }
+
+    // reset to empty buckets covering gains in [-maxGain, maxGain] for
+    // about nodeNum nodes
+    void init(const int maxGain, const int nodeNum)
+    {
+        const long long range = 2LL * maxGain + 1;
+        _maxGain = maxGain;
+        _maxIdx = -1;
+        _size = 0;
+        _scanNum = 0;
+        _sparse = (range > DENSE_LIMIT) && (range > 2LL * nodeNum);
+        _sparseBucket.clear();
+        if (_sparse)
+        {
+            _bucket.clear();
+            _bits.clear();
+            _summary.clear();
+        }
+        else
+        {
+            _bucket.assign(range, NULL);
+            _bits.assign((range + 63) / 64, 0);
+            _summary.assign((_bits.size() + 63) / 64, 0);
+        }
+    }
+
+    // push node to the front of the bucket of gain
+    void insert(Node *node, const int gain)
+    {
+        Node *&head = getHead(gain);
+        node->setPrev(NULL);
+        node->setNext(head);
+        if (head != NULL)
+            head->setPrev(node);
+        else if (!_sparse)
+            setBit(gain + _maxGain);
+        head = node;
+        if (!_sparse && gain + _maxGain > _maxIdx)
+            _maxIdx = gain + _maxGain;
+        ++_size;
+    }
+
+    // unlink node from the bucket of gain
+    void remove(Node *node, const int gain)
+    {
+        Node *prev = node->getPrev();
+        Node *next = node->getNext();
+        if (prev != NULL)
+            prev->setNext(next);
+        else if (_sparse)
+        {
+            if (next != NULL)
+                _sparseBucket[gain] = next;
+            else
+                _sparseBucket.erase(gain);
+        }
+        else
+        {
+            _bucket[gain + _maxGain] = next;
+            if (next == NULL)
+                clearBit(gain + _maxGain);
+        }
+        if (next != NULL)
+            next->setPrev(prev);
+        node->setPrev(NULL);
+        node->setNext(NULL);
+        --_size;
+    }
+
+    // move node from the bucket of oldGain to the bucket of newGain
+    void update(Node *node, const int oldGain, const int newGain)
+    {
+        remove(node, oldGain);
+        insert(node, newGain);
+    }
+
+    // node with the highest gain, NULL if all buckets are empty
+    Node *getMaxGainNode()
+    {
+        if (_sparse)
+            return _sparseBucket.empty() ? NULL : _sparseBucket.rbegin()->second;
+        if (_maxIdx >= 0 && _bucket[_maxIdx] == NULL)
+            _maxIdx = findBelow(_maxIdx);
+        return (_maxIdx >= 0) ? _bucket[_maxIdx] : NULL;
+    }
+
+    // node after node (in the bucket of gain) in descending gain order,
+    // NULL after the last
+    Node *getNextNode(Node *node, const int gain)
+    {
+        if (node->getNext() != NULL)
+            return node->getNext();
+        if (_sparse)
+        {
+            map<int, Node *>::iterator it = _sparseBucket.lower_bound(gain);
+            return (it == _sparseBucket.begin()) ? NULL : (--it)->second;
+        }
+        const int idx = findBelow(gain + _maxGain);
+        return (idx >= 0) ? _bucket[idx] : NULL;
+    }
+
+private:
+    static const long long DENSE_LIMIT = 1 << 16; // always dense up to this many buckets
+
+    int _maxGain;                       // gain range is [-_maxGain, _maxGain]
+    int _maxIdx;                        // no bucket above this index is non-empty
+    int _size;                          // number of nodes in the buckets
+    bool _sparse;                       // heads kept in _sparseBucket
+    vector<Node *> _bucket;             // head node of each gain bucket
+    vector<unsigned long long> _bits;   // bit i: bucket i is non-empty
+    vector<unsigned long long> _summary; // bit i: _bits[i] is non-zero
+    map<int, Node *> _sparseBucket;     // head node of each non-empty gain
+    long long _scanNum;                 // bitmap words read by findBelow
+
+    Node *&getHead(const int gain)
+    {
+        return _sparse ? _sparseBucket[gain] : _bucket[gain + _maxGain];
+    }
+
+    void setBit(const int idx)
+    {
+        _bits[idx >> 6] |= 1ULL << (idx & 63);
+        _summary[idx >> 12] |= 1ULL << ((idx >> 6) & 63);
+    }
+
+    void clearBit(const int idx)
+    {
+        _bits[idx >> 6] &= ~(1ULL << (idx & 63));
+        if (_bits[idx >> 6] == 0)
+            _summary[idx >> 12] &= ~(1ULL << ((idx >> 6) & 63));
+    }
+
+    static int highestBit(const unsigned long long word) { return 63 - __builtin_clzll(word); }
+
+    // highest non-empty bucket index below idx, -1 if none
+    int findBelow(const int idx)
+    {
+        if (idx <= 0)
+            return -1;
+#ifndef FM_NO_STATS
+        ++_scanNum;
+#endif
+        const int top = idx - 1;
+        int word = top >> 6;
+        unsigned long long bits = _bits[word] & (~0ULL >> (63 - (top & 63)));
+        if (bits != 0)
+            return (word << 6) + highestBit(bits);
+
+        // next non-empty word through the summary
+        int sum = word >> 6;
+        unsigned long long sumBits = _summary[sum] & ((1ULL << (word & 63)) - 1);
+        while (sumBits == 0)
+        {
+            if (--sum < 0)
+                return -1;
+            sumBits = _summary[sum];
+#ifndef FM_NO_STATS
+            ++_scanNum;
+#endif
+        }
+        word = (sum << 6) + highestBit(sumBits);
+        return (word << 6) + highestBit(_bits[word]);
+    }
+};
+
+#endif // BUCKET_H
@@ -0,0 +1,315 @@
+#include "eco.h"
+#include "hypergraph.h"
+#include "partitioner.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// nets larger than this do not widen the region, they would pull in most of the design
+static const int WIDEN_NET_SIZE_LIMIT = 1000;
+
+// weight of the net if its pins lie on both sides, read from the sides
+static int cutWeight(const Partitioner &partitioner, const int netId)
+{
+    const Hypergraph &graph = partitioner.getGraph();
+    IdSpan cl = graph.getCellList(netId);
+    for (int k = 1; k < cl.size(); k++)
+    {
+        if (partitioner.getPart(cl[k]) != partitioner.getPart(cl[0]))
+            return graph.getNetWeight(netId);
+    }
+    return 0;
+}
+
+// net netId and net previousNetId of the previous circuit have the same pins
+static bool samePins(const Hypergraph &graph, const int netId, const Hypergraph &previous, const int previousNetId,
+                     const vector<int> &previousId, vector<int> &pins, vector<int> &previousPins)
+{
+    IdSpan cl = graph.getCellList(netId);
+    IdSpan previousCl = previous.getCellList(previousNetId);
+    if (cl.size() != previousCl.size())
+        return false;
+    // the pins usually keep their order, otherwise compare them sorted
+    int k = 0;
+    while (k < cl.size() && previousId[cl[k]] == previousCl[k])
+        ++k;
+    if (k == cl.size())
+        return true;
+    pins.clear();
+    previousPins.clear();
+    for (k = 0; k < cl.size(); k++)
+    {
+        pins.push_back(previousId[cl[k]]);
+        previousPins.push_back(previousCl[k]);
+    }
+    sort(pins.begin(), pins.end());
+    sort(previousPins.begin(), previousPins.end());
+    return pins == previousPins;
+}
+
+static void addCell(vector<int> &region, vector<char> &inRegion, const int cellId)
+{
+    if (!inRegion[cellId])
+    {
+        inRegion[cellId] = 1;
+        region.push_back(cellId);
+    }
+}
+
+bool Eco::readNetlist(const char *fileName)
+{
+    _previous.setVerbose(false);
+    return _previous.parseFile(fileName);
+}
+
+bool Eco::readResult(const char *fileName)
+{
+    fstream inFile(fileName, ios::in);
+    if (!inFile)
+        return false;
+    vector<char> listed;
+    if (_previous.readResult(inFile, listed, &_previousCutSize) != 0)
+        return false;
+    for (size_t i = 0; i < listed.size(); i++)
+    {
+        if (!listed[i])
+            return false;
+    }
+    if (_previousCutSize < 0)
+    {
+        // no Cutsize line, count it once on the previous circuit
+        _previous.countNetPartCount();
+        _previous.countCutsize();
+        _previousCutSize = _previous.getCutSize();
+    }
+
+    // match the cells by name, the kept ones take their previous side
+    const Hypergraph &graph = _partitioner.getGraph();
+    const NamePool &previousNames = _previous.getGraph().getCellNames();
+    _previousId.assign(graph.getCellNum(), -1);
+    _keptNum = 0;
+    _newCells.clear();
+    for (int i = 0; i < graph.getCellNum(); i++)
+    {
+        const int previousId = previousNames.find(graph.getCellName(i), graph.getCellNames().getLength(i));
+        _previousId[i] = previousId;
+        if (previousId < 0)
+            _newCells.push_back(i);
+        else
+        {
+            ++_keptNum;
+            _partitioner.setPart(i, _previous.getPart(previousId));
+        }
+    }
+    _newNum = _newCells.size();
+    _removedNum = _previous.getCellNum() - _keptNum;
+    return true;
+}
+
+void Eco::placeNewCells()
+{
+    const Hypergraph &graph = _partitioner.getGraph();
+    _partitioner.countBalanceBound();
+    const int ub = _partitioner.getUpperBound();
+    vector<char> placed(graph.getCellNum(), 1);
+    for (size_t i = 0; i < _newCells.size(); i++)
+    {
+        placed[_newCells[i]] = 0;
+    }
+
+    int partSize[2] = {0, 0};
+    for (int i = 0; i < graph.getCellNum(); i++)
+    {
+        if (placed[i])
+            partSize[_partitioner.getPart(i)] += graph.getCellWeight(i);
+    }
+
+    // join the side holding more of the placed neighbours, weighted by net
+    for (size_t i = 0; i < _newCells.size(); i++)
+    {
+        const int cellId = _newCells[i];
+        const int weight = graph.getCellWeight(cellId);
+        long long pull[2] = {0, 0};
+        IdSpan nl = graph.getNetList(cellId);
+        for (int j = 0; j < nl.size(); j++)
+        {
+            IdSpan cl = graph.getCellList(nl[j]);
+            for (int k = 0; k < cl.size(); k++)
+            {
+                if (placed[cl[k]])
+                    pull[_partitioner.getPart(cl[k])] += graph.getNetWeight(nl[j]);
+            }
+        }
+        bool part = (pull[0] != pull[1]) ? pull[1] > pull[0] : partSize[1] < partSize[0];
+        if (partSize[part] + weight > ub)
+            part = !part;
+        _partitioner.setPart(cellId, part);
+        partSize[part] += weight;
+        placed[cellId] = 1;
+    }
+}
+
+void Eco::diff(vector<int> &region, vector<char> &inRegion)
+{
+    const Hypergraph &graph = _partitioner.getGraph();
+    const Hypergraph &previous = _previous.getGraph();
+    vector<int> currentId(previous.getCellNum(), -1);
+    for (int i = 0; i < graph.getCellNum(); i++)
+    {
+        if (_previousId[i] >= 0)
+            currentId[_previousId[i]] = i;
+    }
+
+    // the new cells and the cells whose weight changed
+    for (int i = 0; i < graph.getCellNum(); i++)
+    {
+        if (_previousId[i] < 0 || graph.getCellWeight(i) != previous.getCellWeight(_previousId[i]))
+            addCell(region, inRegion, i);
+    }
+
+    // a net matched by name that keeps its weight and pins is cut as before;
+    // any other net's pins are seeded and its cut replaces the previous one.
+    // Repeated net names leave the name pool short, then no net is matched
+    const bool named = graph.getNetNames().getSize() == graph.getNetNum() &&
+                       previous.getNetNames().getSize() == previous.getNetNum();
+    int cutSize = _previousCutSize;
+    vector<char> matched(previous.getNetNum(), 0);
+    vector<int> pins, previousPins;
+    _changedNum = 0;
+    for (int i = 0; i < graph.getNetNum(); i++)
+    {
+        const int j = named ? previous.getNetNames().find(graph.getNetName(i), graph.getNetNames().getLength(i)) : -1;
+        if (j >= 0)
+        {
+            matched[j] = 1;
+            if (graph.getNetWeight(i) == previous.getNetWeight(j) &&
+                samePins(graph, i, previous, j, _previousId, pins, previousPins))
+                continue;
+            cutSize -= cutWeight(_previous, j);
+            IdSpan previousCl = previous.getCellList(j);
+            for (int k = 0; k < previousCl.size(); k++)
+            {
+                if (currentId[previousCl[k]] >= 0)
+                    addCell(region, inRegion, currentId[previousCl[k]]);
+            }
+        }
+        ++_changedNum;
+        cutSize += cutWeight(_partitioner, i);
+        IdSpan cl = graph.getCellList(i);
+        for (int k = 0; k < cl.size(); k++)
+        {
+            addCell(region, inRegion, cl[k]);
+        }
+    }
+    for (int j = 0; j < previous.getNetNum(); j++)
+    {
+        if (matched[j])
+            continue;
+        // a removed net
+        ++_changedNum;
+        cutSize -= cutWeight(_previous, j);
+        IdSpan previousCl = previous.getCellList(j);
+        for (int k = 0; k < previousCl.size(); k++)
+        {
+            if (currentId[previousCl[k]] >= 0)
+                addCell(region, inRegion, currentId[previousCl[k]]);
+        }
+    }
+    _partitioner.setCutSize(cutSize);
+}
+
+void Eco::widen(vector<int> &region, vector<char> &inRegion) const
+{
+    const Hypergraph &graph = _partitioner.getGraph();
+    const size_t end = region.size();
+    for (size_t i = 0; i < end; i++)
+    {
+        IdSpan nl = graph.getNetList(region[i]);
+        for (int j = 0; j < nl.size(); j++)
+        {
+            if (graph.getNetSize(nl[j]) > WIDEN_NET_SIZE_LIMIT)
+                continue;
+            IdSpan cl = graph.getCellList(nl[j]);
+            for (int k = 0; k < cl.size(); k++)
+            {
+                addCell(region, inRegion, cl[k]);
+            }
+        }
+    }
+}
+
+void Eco::count(const vector<int> &region, const size_t begin)
+{
+    // the nets of region[begin, end) not counted yet, then the gains of
+    // those cells; moves of region cells keep the counted nets up to date
+    const Hypergraph &graph = _partitioner.getGraph();
+    vector<int> nets;
+    for (size_t i = begin; i < region.size(); i++)
+    {
+        IdSpan nl = graph.getNetList(region[i]);
+        for (int j = 0; j < nl.size(); j++)
+        {
+            if (!_counted[nl[j]])
+            {
+                _counted[nl[j]] = 1;
+                nets.push_back(nl[j]);
+            }
+        }
+    }
+    _partitioner.countNetPartCount(nets);
+    _partitioner.countGain(vector<int>(region.begin() + begin, region.end()));
+}
+
+bool Eco::partition()
+{
+    const int cellNum = _partitioner.getCellNum();
+    placeNewCells();
+    _partitioner.countPartsize();
+    _partitioner.countMaxPinNum();
+    _partitioner.lockAll();
+
+    // seed with the new cells and the pins of the changed nets
+    vector<int> region;
+    vector<char> inRegion(cellNum, 0);
+    diff(region, inRegion);
+    _counted.assign(_partitioner.getNetNum(), 0);
+    if (_verbose)
+        cout << "****eco: " << _keptNum << " cells kept, " << _newNum << " new, " << _removedNum << " removed, "
+             << _changedNum << " nets changed, cutsize " << _partitioner.getCutSize() << "****" << endl;
+    if (region.empty() && _partitioner.isBalanced())
+        return true;
+
+    size_t countedNum = 0; // region[0, countedNum) have counted gains
+    for (int hop = 1;; hop++)
+    {
+        const size_t size = region.size();
+        widen(region, inRegion);
+        if (region.size() == size && hop > 1)
+            break;
+        count(region, countedNum);
+        countedNum = region.size();
+        const int gain = _partitioner.refineRegion(region);
+        if (_verbose)
+            cout << "hop " << hop << ": region " << region.size() << " cells, gain " << gain << ", cutsize "
+                 << _partitioner.getCutSize() << endl;
+        if ((gain <= 0 && _partitioner.isBalanced()) || hop >= _maxHop || (int)region.size() == cellNum)
+            break;
+    }
+
+    // the neighbourhood could not restore the balance: count everything,
+    // move the best cells off the heavy side, then refine the whole design
+    if (!_partitioner.isBalanced())
+    {
+        if (_verbose)
+            cout << "region out of balance, rebalancing and refining the whole design" << endl;
+        _partitioner.countNetPartCount();
+        _partitioner.countCutsize();
+        _partitioner.countGain();
+        if (!_partitioner.rebalance())
+            return false;
+        _partitioner.refine();
+    }
+    return _partitioner.isBalanced();
+}
@@ -0,0 +1,65 @@
+#ifndef ECO_H
+#define ECO_H
+
+#include "partitioner.h"
+#include <vector>
+using namespace std;
+
+// ECO repartitioning: start from the result file of an earlier run on a
+// slightly different netlist instead of from scratch. The previous and the
+// edited netlist are diffed by name: cells keep their previous side, new
+// cells go to the side most of their neighbours are on, and a net is
+// changed if it is new, gone, or its pins or weight differ. FM then only
+// moves the new cells and the pins of the changed nets, widening that
+// region by one net hop at a time while the previous round improved the
+// cut or the partition is out of balance. Part counts and gains are only
+// counted for the nets and cells the region reaches, and the cutsize is
+// the previous one corrected by the changed nets, so past the diff the
+// work grows with the size of the change rather than the circuit.
+class Eco
+{
+public:
+    // constructor and destructor
+    Eco(Partitioner &partitioner)
+        : _partitioner(partitioner), _maxHop(8), _verbose(partitioner.getVerbose()), _previousCutSize(0),
+          _keptNum(0), _newNum(0), _removedNum(0), _changedNum(0) {}
+    ~Eco() {}
+
+    // basic access methods
+    int getKeptNum() const { return _keptNum; }
+    int getNewNum() const { return _newNum; }
+    int getRemovedNum() const { return _removedNum; }
+    int getChangedNum() const { return _changedNum; }
+
+    // set functions
+    void setMaxHop(const int maxHop) { _maxHop = maxHop; }
+    void setVerbose(const bool verbose) { _verbose = verbose; }
+
+    // modify methods
+    bool readNetlist(const char *fileName); // the previous netlist, false if it cannot be read
+    // the previous result, false if it is not a 2-way result listing
+    // exactly the cells of the previous netlist
+    bool readResult(const char *fileName);
+    bool partition(); // false if the balance cannot be restored
+
+private:
+    Partitioner &_partitioner; // edited circuit, receives the result
+    Partitioner _previous;     // previous circuit with the sides of the previous result
+    int _maxHop;               // widening rounds before the region stops growing
+    bool _verbose;             // print the region of each round
+    int _previousCutSize;      // cutsize of the previous result
+    int _keptNum;              // cells found in the previous result
+    int _newNum;               // cells not in the previous result
+    int _removedNum;           // cells of the previous result not in the circuit
+    int _changedNum;           // nets added, removed or changed
+    vector<int> _previousId;   // id in the previous circuit of each cell, -1 if new
+    vector<int> _newCells;     // ids of the new cells
+    vector<char> _counted;     // nets whose part counts are valid
+
+    void placeNewCells();
+    void diff(vector<int> &region, vector<char> &inRegion);
+    void widen(vector<int> &region, vector<char> &inRegion) const;
+    void count(const vector<int> &region, const size_t begin);
+};
+
+#endif // ECO_H
@@ -0,0 +1,114 @@
+#include "evaluator.h"
+#include "hypergraph.h"
+#include <stdint.h>
+#include <vector>
+using namespace std;
+
+// bit-sliced counter planes per word, enough for counts below 2^32
+static const int PLANE_NUM = 32;
+
+// add 1 to the counters of the candidates marked in carry
+static inline void addMask(uint64_t *plane, uint64_t carry)
+{
+    for (int k = 0; carry != 0; k++)
+    {
+        const uint64_t next = plane[k] & carry;
+        plane[k] ^= carry;
+        carry = next;
+    }
+}
+
+// add weight to the counters of the candidates marked in mask
+static inline void addWeight(long long *count, uint64_t mask, const int weight)
+{
+    while (mask != 0)
+    {
+        count[__builtin_ctzll(mask)] += weight;
+        mask &= mask - 1;
+    }
+}
+
+// add the bit-sliced counters of every candidate to its plain count
+static void readPlanes(const vector<uint64_t> &plane, const int candidateNum, vector<long long> &count)
+{
+    for (int c = 0; c < candidateNum; c++)
+    {
+        const uint64_t *p = &plane[(size_t)(c / 64) * PLANE_NUM];
+        long long value = 0;
+        for (int k = 0; k < PLANE_NUM; k++)
+        {
+            value |= (long long)((p[k] >> (c % 64)) & 1) << k;
+        }
+        count[c] += value;
+    }
+}
+
+void CutEvaluator::countCutsize(const vector<uint64_t> &bits, const int candidateNum,
+                                vector<long long> &cutSize) const
+{
+    const int wordNum = getWordNum(candidateNum);
+    vector<uint64_t> plane((size_t)wordNum * PLANE_NUM, 0);
+    vector<uint64_t> andWord(wordNum), orWord(wordNum);
+    vector<long long> weighted((size_t)wordNum * 64, 0);
+
+    for (int i = 0; i < _graph.getNetNum(); i++)
+    {
+        IdSpan cl = _graph.getCellList(i);
+        if (cl.size() < 2)
+            continue;
+
+        // a candidate cuts the net if its bits differ among the pins
+        const uint64_t *word = &bits[(size_t)cl[0] * wordNum];
+        for (int w = 0; w < wordNum; w++)
+        {
+            andWord[w] = word[w];
+            orWord[w] = word[w];
+        }
+        for (int j = 1; j < cl.size(); j++)
+        {
+            word = &bits[(size_t)cl[j] * wordNum];
+            for (int w = 0; w < wordNum; w++)
+            {
+                andWord[w] &= word[w];
+                orWord[w] |= word[w];
+            }
+        }
+
+        const int weight = _graph.getNetWeight(i);
+        for (int w = 0; w < wordNum; w++)
+        {
+            const uint64_t cut = orWord[w] & ~andWord[w];
+            if (weight == 1)
+                addMask(&plane[(size_t)w * PLANE_NUM], cut);
+            else
+                addWeight(&weighted[(size_t)w * 64], cut, weight);
+        }
+    }
+
+    cutSize.assign(weighted.begin(), weighted.begin() + candidateNum);
+    readPlanes(plane, candidateNum, cutSize);
+}
+
+void CutEvaluator::countPartsize(const vector<uint64_t> &bits, const int candidateNum,
+                                 vector<long long> &partSizeB) const
+{
+    const int wordNum = getWordNum(candidateNum);
+    vector<uint64_t> plane((size_t)wordNum * PLANE_NUM, 0);
+    vector<long long> weighted((size_t)wordNum * 64, 0);
+
+    for (int i = 0; i < _graph.getCellNum(); i++)
+    {
+        const uint64_t *word = &bits[(size_t)i * wordNum];
+        const int weight = _graph.getCellWeight(i);
+        for (int w = 0; w < wordNum; w++)
+        {
+            if (weight == 1)
+                addMask(&plane[(size_t)w * PLANE_NUM], word[w]);
+            else
+                addWeight(&weighted[(size_t)w * 64], word[w], weight);
+        }
+    }
+
+    partSizeB.assign(weighted.begin(), weighted.begin() + candidateNum);
+    readPlanes(plane, candidateNum, partSizeB);
+}
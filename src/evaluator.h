@@ -0,0 +1,51 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include "hypergraph.h"
+#include <stdint.h>
+#include <vector>
+using namespace std;
+
+// Scores many 2-way partitions of one circuit in a single sweep. The
+// candidates are bit-packed cell-major: cell i owns the words
+// bits[i * W, (i + 1) * W) with W = getWordNum(candidateNum), and bit c % 64
+// of word c / 64 is the side of the cell in candidate c.
+//
+// For each net the pin words are ANDed and ORed, so OR & ~AND marks the
+// candidates that cut the net, 64 per word. The marks of unit weight nets
+// (and cells) go into bit-sliced counters: plane k of a word holds bit k
+// of the 64 counts, so adding a mark is a carry chain of a few word
+// operations instead of 64 scalar adds.
+class CutEvaluator
+{
+public:
+    // constructor and destructor
+    CutEvaluator(const Hypergraph &graph) : _graph(graph) {}
+    ~CutEvaluator() {}
+
+    // basic access methods
+    static int getWordNum(const int candidateNum) { return (candidateNum + 63) / 64; }
+    static bool getPart(const vector<uint64_t> &bits, const int candidateNum, const int cellId, const int candidate)
+    {
+        return (bits[(size_t)cellId * getWordNum(candidateNum) + candidate / 64] >> (candidate % 64)) & 1;
+    }
+
+    // set functions
+    static void setPart(vector<uint64_t> &bits, const int candidateNum, const int cellId, const int candidate,
+                        const bool part)
+    {
+        uint64_t &word = bits[(size_t)cellId * getWordNum(candidateNum) + candidate / 64];
+        const uint64_t mask = (uint64_t)1 << (candidate % 64);
+        word = part ? (word | mask) : (word & ~mask);
+    }
+
+    // modify methods
+    // bits must hold getCellNum() * getWordNum(candidateNum) words
+    void countCutsize(const vector<uint64_t> &bits, const int candidateNum, vector<long long> &cutSize) const;
+    void countPartsize(const vector<uint64_t> &bits, const int candidateNum, vector<long long> &partSizeB) const;
+
+private:
+    const Hypergraph &_graph; // circuit shared by all candidates
+};
+
+#endif // EVALUATOR_H
@@ -0,0 +1,551 @@
+#include "hypergraph.h"
+#include "binaryio.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+static const char CACHE_MAGIC[8] = {'F', 'M', 'G', 'R', 'A', 'P', 'H', '\0'};
+static const uint32_t CACHE_VERSION = 1;
+
+// countLocalityOrder() does not walk nets with more pins than this, they
+// would put most of the circuit into one BFS level
+static const int ORDER_NET_SIZE_LIMIT = 1000;
+
+// Header of the binary cache, followed by the padded sections written by
+// Hypergraph::save(). Integers are stored in the native byte order.
+struct CacheHeader
+{
+    char magic[8];        // CACHE_MAGIC
+    uint32_t version;     // CACHE_VERSION
+    uint32_t headerSize;  // sizeof(CacheHeader), catches layout changes
+    uint64_t payloadSize; // bytes after the header
+    uint64_t checksum;    // checksumWords() of the payload
+    int64_t sourceSize;   // size of the .dat file the cache was made from
+    int64_t sourceTime;   // its modification time in nanoseconds
+    double bFactor;       // balance factor of the .dat file
+    int32_t netNum;
+    int32_t cellNum;
+    int32_t pinNum;
+    int32_t maxPinNum;
+    int32_t maxNetWeightSum;
+    int32_t totalWeight;
+    int32_t hasCellWeight;
+    int32_t hasNetWeight;
+};
+
+void Hypergraph::build(const int cellNum, vector<int> &netOffset, vector<int> &netPins)
+{
+    _netOffset.swap(netOffset);
+    _netPins.swap(netPins);
+    const int netNum = (int)_netOffset.size() - 1;
+
+    // count the degree of each cell, then prefix sum into offsets
+    _cellOffset.assign(cellNum + 1, 0);
+    for (size_t i = 0, end = _netPins.size(); i < end; ++i)
+    {
+        ++_cellOffset[_netPins[i] + 1];
+    }
+    _maxPinNum = 0;
+    for (int i = 0; i < cellNum; i++)
+    {
+        _maxPinNum = max(_maxPinNum, _cellOffset[i + 1]);
+        _cellOffset[i + 1] += _cellOffset[i];
+    }
+
+    // scatter net ids; walking nets in order keeps each cell's list sorted
+    _cellNets.resize(_netPins.size());
+    vector<int> fill(_cellOffset.begin(), _cellOffset.end() - 1);
+    for (int i = 0; i < netNum; i++)
+    {
+        for (int j = _netOffset[i]; j < _netOffset[i + 1]; j++)
+        {
+            _cellNets[fill[_netPins[j]]++] = i;
+        }
+    }
+
+    _netNum = netNum;
+    _cellNum = cellNum;
+    _pinNum = _netPins.size();
+    bindData();
+}
+
+bool Hypergraph::buildCoded(const int cellNum, vector<unsigned char> &netCode, vector<unsigned> &netCodeOffset)
+{
+    _netCode.swap(netCode);
+    _netCodeOffset.swap(netCodeOffset);
+    const int netNum = _netCodeOffset.size();
+
+    // count the degree of each cell, then prefix sum into start positions
+    vector<int> cellStart(cellNum + 1, 0);
+    int pinNum = 0;
+    for (int i = 0; i < netNum; i++)
+    {
+        CodedSpan cl = getCodedCellList(i);
+        for (CodedSpan::Iterator it = cl.begin(); it != cl.end(); ++it)
+        {
+            ++cellStart[*it + 1];
+        }
+        pinNum += cl.size();
+    }
+    _maxPinNum = 0;
+    for (int i = 0; i < cellNum; i++)
+    {
+        _maxPinNum = max(_maxPinNum, cellStart[i + 1]);
+        cellStart[i + 1] += cellStart[i];
+    }
+
+    // scatter the net ids cell-major, plain only for this step, then code
+    // the run of each cell; walking nets in order keeps every run ascending
+    vector<int> cellNets(pinNum);
+    for (int i = 0; i < netNum; i++)
+    {
+        CodedSpan cl = getCodedCellList(i);
+        for (CodedSpan::Iterator it = cl.begin(); it != cl.end(); ++it)
+        {
+            cellNets[cellStart[*it]++] = i;
+        }
+    }
+    _cellCode.clear();
+    _cellCode.reserve(_netCode.size());
+    _cellCodeOffset.resize(cellNum);
+    for (int i = 0, begin = 0; i < cellNum; begin = cellStart[i++])
+    {
+        if (_cellCode.size() > UINT_MAX)
+            return false;
+        _cellCodeOffset[i] = _cellCode.size();
+        CodedSpan::encode(cellNets.data() + begin, cellNets.data() + cellStart[i], _cellCode);
+    }
+    _cellCode.shrink_to_fit();
+
+    _netNum = netNum;
+    _cellNum = cellNum;
+    _pinNum = pinNum;
+    bindData();
+    return true;
+}
+
+void Hypergraph::setCellWeight(vector<int> &cellWeight)
+{
+    _cellWeight.swap(cellWeight);
+    _totalWeight = 0;
+    for (size_t i = 0, end = _cellWeight.size(); i < end; ++i)
+    {
+        _totalWeight += _cellWeight[i];
+    }
+    bindData();
+}
+
+void Hypergraph::setNetWeight(vector<int> &netWeight)
+{
+    _netWeight.swap(netWeight);
+    _maxNetWeightSum = 0;
+    for (int i = 0, cellNum = getCellNum(); i < cellNum; i++)
+    {
+        int sum = 0;
+        if (isCoded())
+        {
+            CodedSpan nl = getCodedNetList(i);
+            for (CodedSpan::Iterator it = nl.begin(); it != nl.end(); ++it)
+            {
+                sum += _netWeight[*it];
+            }
+        }
+        else
+        {
+            for (int j = _cellOffset[i]; j < _cellOffset[i + 1]; j++)
+            {
+                sum += _netWeight[_cellNets[j]];
+            }
+        }
+        _maxNetWeightSum = max(_maxNetWeightSum, sum);
+    }
+    bindData();
+}
+
+void Hypergraph::setNames(NamePool &cellNames, NamePool &netNames)
+{
+    _cellNames.swap(cellNames);
+    _netNames.swap(netNames);
+}
+
+void Hypergraph::contract(const vector<int> &cellMap, const int clusterNum, Hypergraph &coarse) const
+{
+    vector<int> netOffset(1, 0);
+    vector<int> netPins;
+    vector<int> netWeight;
+    vector<int> lastNet(clusterNum, -1);            // last net a cluster was added to
+    vector<int> sameHash;                           // previous coarse net with the same pin hash
+    unordered_map<unsigned long long, int> lastHash; // latest coarse net of each pin hash
+    netPins.reserve(_pinNum);
+
+    for (int i = 0, netNum = getNetNum(); i < netNum; i++)
+    {
+        const int start = netPins.size();
+        for (int j = _netOffsetData[i]; j < _netOffsetData[i + 1]; j++)
+        {
+            const int cluster = cellMap[_netPinsData[j]];
+            if (cluster >= 0 && lastNet[cluster] != i)
+            {
+                lastNet[cluster] = i;
+                netPins.push_back(cluster);
+            }
+        }
+        // a net inside one cluster can never be cut
+        if (netPins.size() - start < 2)
+        {
+            netPins.resize(start);
+            continue;
+        }
+
+        // a net with the same clusters as an earlier one is cut together
+        // with it, so only its weight is kept
+        sort(netPins.begin() + start, netPins.end());
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t j = start; j < netPins.size(); j++)
+        {
+            hash = (hash ^ (unsigned)netPins[j]) * 1099511628211ULL;
+        }
+        const int size = netPins.size() - start;
+        unordered_map<unsigned long long, int>::iterator it = lastHash.find(hash);
+        int same = (it != lastHash.end()) ? it->second : -1;
+        for (; same >= 0; same = sameHash[same])
+        {
+            if (netOffset[same + 1] - netOffset[same] == size &&
+                equal(netPins.begin() + start, netPins.end(), netPins.begin() + netOffset[same]))
+                break;
+        }
+        if (same >= 0)
+        {
+            netWeight[same] += getNetWeight(i);
+            netPins.resize(start);
+            continue;
+        }
+
+        sameHash.push_back((it != lastHash.end()) ? it->second : -1);
+        lastHash[hash] = netWeight.size();
+        netWeight.push_back(getNetWeight(i));
+        netOffset.push_back(netPins.size());
+    }
+
+    vector<int> cellWeight(clusterNum, 0);
+    for (int i = 0, cellNum = getCellNum(); i < cellNum; i++)
+    {
+        if (cellMap[i] >= 0)
+            cellWeight[cellMap[i]] += getCellWeight(i);
+    }
+
+    coarse.clear();
+    coarse.build(clusterNum, netOffset, netPins);
+    coarse.setCellWeight(cellWeight);
+    coarse.setNetWeight(netWeight);
+}
+
+void Hypergraph::countLocalityOrder(vector<int> &cellOrder) const
+{
+    const int cellNum = getCellNum();
+
+    // cells by ascending degree (counting sort), the BFS roots are taken in
+    // this order so that every tree starts at a peripheral cell
+    vector<int> degreeStart(_maxPinNum + 2, 0);
+    for (int i = 0; i < cellNum; i++)
+    {
+        ++degreeStart[getCellDegree(i) + 1];
+    }
+    for (int d = 0; d <= _maxPinNum; d++)
+    {
+        degreeStart[d + 1] += degreeStart[d];
+    }
+    vector<int> byDegree(cellNum);
+    for (int i = 0; i < cellNum; i++)
+    {
+        byDegree[degreeStart[getCellDegree(i)]++] = i;
+    }
+
+    vector<char> visited(cellNum, 0);
+    vector<char> walked(getNetNum(), 0);
+    cellOrder.clear();
+    cellOrder.reserve(cellNum);
+    for (int r = 0; r < cellNum; r++)
+    {
+        if (visited[byDegree[r]])
+            continue;
+        visited[byDegree[r]] = 1;
+        cellOrder.push_back(byDegree[r]);
+        for (size_t head = cellOrder.size() - 1; head < cellOrder.size(); head++)
+        {
+            const size_t levelStart = cellOrder.size();
+            IdSpan nl = getNetList(cellOrder[head]);
+            for (int j = 0; j < nl.size(); j++)
+            {
+                if (walked[nl[j]] || getNetSize(nl[j]) > ORDER_NET_SIZE_LIMIT)
+                    continue;
+                walked[nl[j]] = 1;
+                IdSpan cl = getCellList(nl[j]);
+                for (int k = 0; k < cl.size(); k++)
+                {
+                    if (!visited[cl[k]])
+                    {
+                        visited[cl[k]] = 1;
+                        cellOrder.push_back(cl[k]);
+                    }
+                }
+            }
+            // Cuthill-McKee: the new neighbours of a cell by ascending degree
+            sort(cellOrder.begin() + levelStart, cellOrder.end(), [this](const int a, const int b) {
+                const int degreeA = getCellDegree(a), degreeB = getCellDegree(b);
+                return degreeA < degreeB || (degreeA == degreeB && a < b);
+            });
+        }
+    }
+    reverse(cellOrder.begin(), cellOrder.end());
+}
+
+void Hypergraph::renumber(const vector<int> &cellOrder, Hypergraph &ordered) const
+{
+    const int cellNum = getCellNum();
+    const int netNum = getNetNum();
+    vector<int> newId(cellNum);
+    for (int i = 0; i < cellNum; i++)
+    {
+        newId[cellOrder[i]] = i;
+    }
+
+    // nets by their lowest new pin id (counting sort, stable in the old ids)
+    vector<int> firstStart(cellNum + 2, 0);
+    vector<int> firstPin(netNum, cellNum);
+    for (int i = 0; i < netNum; i++)
+    {
+        for (int j = _netOffsetData[i]; j < _netOffsetData[i + 1]; j++)
+        {
+            firstPin[i] = min(firstPin[i], newId[_netPinsData[j]]);
+        }
+        ++firstStart[firstPin[i] + 1];
+    }
+    for (int i = 0; i <= cellNum; i++)
+    {
+        firstStart[i + 1] += firstStart[i];
+    }
+    vector<int> netOrder(netNum);
+    for (int i = 0; i < netNum; i++)
+    {
+        netOrder[firstStart[firstPin[i]]++] = i;
+    }
+
+    vector<int> netOffset(1, 0);
+    vector<int> netPins;
+    vector<int> netWeight;
+    netOffset.reserve(netNum + 1);
+    netPins.reserve(_pinNum);
+    for (int i = 0; i < netNum; i++)
+    {
+        const int net = netOrder[i];
+        for (int j = _netOffsetData[net]; j < _netOffsetData[net + 1]; j++)
+        {
+            netPins.push_back(newId[_netPinsData[j]]);
+        }
+        sort(netPins.begin() + netOffset.back(), netPins.end());
+        netOffset.push_back(netPins.size());
+        if (hasNetWeight())
+            netWeight.push_back(getNetWeight(net));
+    }
+    vector<int> cellWeight;
+    if (hasCellWeight())
+    {
+        cellWeight.resize(cellNum);
+        for (int i = 0; i < cellNum; i++)
+        {
+            cellWeight[i] = getCellWeight(cellOrder[i]);
+        }
+    }
+
+    ordered.clear();
+    ordered.build(cellNum, netOffset, netPins);
+    if (hasCellWeight())
+        ordered.setCellWeight(cellWeight);
+    if (hasNetWeight())
+        ordered.setNetWeight(netWeight);
+
+    // the names follow the ids, so results are still written by name
+    NamePool cellNames, netNames;
+    bool isNew;
+    if (hasNames() && cellNum > 0)
+    {
+        cellNames.reserve(cellNum, _cellNames.getName(cellNum - 1) + _cellNames.getLength(cellNum - 1) -
+                                       _cellNames.getName(0) - cellNum + 1);
+        for (int i = 0; i < cellNum; i++)
+        {
+            cellNames.insert(getCellName(cellOrder[i]), _cellNames.getLength(cellOrder[i]), isNew);
+        }
+    }
+    if (_netNames.getSize() == netNum && netNum > 0)
+    {
+        netNames.reserve(netNum, _netNames.getName(netNum - 1) + _netNames.getLength(netNum - 1) -
+                                     _netNames.getName(0) - netNum + 1);
+        for (int i = 0; i < netNum; i++)
+        {
+            netNames.insert(getNetName(netOrder[i]), _netNames.getLength(netOrder[i]), isNew);
+        }
+    }
+    ordered.setNames(cellNames, netNames);
+}
+
+size_t Hypergraph::getMemoryUsage() const
+{
+    return sizeof(int) * (_netOffset.capacity() + _netPins.capacity() + _cellOffset.capacity() +
+                          _cellNets.capacity() + _cellWeight.capacity() + _netWeight.capacity()) +
+           _netCode.capacity() + _cellCode.capacity() +
+           sizeof(unsigned) * (_netCodeOffset.capacity() + _cellCodeOffset.capacity());
+}
+
+void Hypergraph::clear()
+{
+    _netNum = 0;
+    _cellNum = 0;
+    _pinNum = 0;
+    _maxPinNum = 0;
+    _maxNetWeightSum = 0;
+    _totalWeight = 0;
+    _cellWeight.clear();
+    _netWeight.clear();
+    _netOffset.assign(1, 0);
+    _netPins.clear();
+    _cellOffset.assign(1, 0);
+    _cellNets.clear();
+    _netCode.clear();
+    _netCodeOffset.clear();
+    _cellCode.clear();
+    _cellCodeOffset.clear();
+    _cellNames.clear();
+    _netNames.clear();
+    _mapping.reset();
+    bindData();
+}
+
+void Hypergraph::bindData()
+{
+    _netOffsetData = _netOffset.data();
+    _netPinsData = _netPins.data();
+    _cellOffsetData = _cellOffset.data();
+    _cellNetsData = _cellNets.data();
+    _cellWeightData = _cellWeight.empty() ? NULL : _cellWeight.data();
+    _netWeightData = _netWeight.empty() ? NULL : _netWeight.data();
+}
+
+bool Hypergraph::isCacheFile(const char *data, const size_t size)
+{
+    return size >= sizeof(CACHE_MAGIC) && memcmp(data, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0;
+}
+
+bool Hypergraph::save(const char *fileName, const double bFactor, const long long sourceSize, const long long sourceTime) const
+{
+    if (isCoded())
+        return false;
+
+    // write a temporary file and rename it, so readers never see half a cache
+    const string tmpName = string(fileName) + ".tmp";
+    FILE *file = fopen(tmpName.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    BinaryWriter writer(file);
+    writer.write(_netOffsetData, sizeof(int) * (_netNum + 1));
+    writer.write(_netPinsData, sizeof(int) * _pinNum);
+    writer.write(_cellOffsetData, sizeof(int) * (_cellNum + 1));
+    writer.write(_cellNetsData, sizeof(int) * _pinNum);
+    if (hasCellWeight())
+        writer.write(_cellWeightData, sizeof(int) * _cellNum);
+    if (hasNetWeight())
+        writer.write(_netWeightData, sizeof(int) * _netNum);
+    _cellNames.save(writer);
+    _netNames.save(writer);
+
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.headerSize = sizeof(CacheHeader);
+    header.payloadSize = writer.getSize();
+    header.checksum = writer.getChecksum();
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.bFactor = bFactor;
+    header.netNum = _netNum;
+    header.cellNum = _cellNum;
+    header.pinNum = _pinNum;
+    header.maxPinNum = _maxPinNum;
+    header.maxNetWeightSum = _maxNetWeightSum;
+    header.totalWeight = _totalWeight;
+    header.hasCellWeight = hasCellWeight();
+    header.hasNetWeight = hasNetWeight();
+    ok = ok && writer.isOk() && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmpName.c_str(), fileName) != 0)
+    {
+        remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Hypergraph::load(const char *fileName, double &bFactor, long long &sourceSize, long long &sourceTime)
+{
+    clear();
+    shared_ptr<MappedFile> mapping(new MappedFile());
+    if (!mapping->open(fileName) || mapping->getSize() < sizeof(CacheHeader))
+        return false;
+
+    // reject other formats, versions and corrupted payloads
+    CacheHeader header;
+    memcpy(&header, mapping->getData(), sizeof(header));
+    const char *payload = mapping->getData() + sizeof(header);
+    const size_t payloadSize = mapping->getSize() - sizeof(header);
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.headerSize != sizeof(CacheHeader) || header.payloadSize != payloadSize ||
+        header.netNum < 0 || header.cellNum < 0 || header.pinNum < 0 ||
+        header.checksum != checksumWords(CHECKSUM_SEED, payload, payloadSize))
+        return false;
+
+    BinaryReader reader(payload, payloadSize);
+    const int *netOffset = (const int *)reader.read(sizeof(int) * (header.netNum + 1));
+    const int *netPins = (const int *)reader.read(sizeof(int) * header.pinNum);
+    const int *cellOffset = (const int *)reader.read(sizeof(int) * (header.cellNum + 1));
+    const int *cellNets = (const int *)reader.read(sizeof(int) * header.pinNum);
+    const int *cellWeight = header.hasCellWeight ? (const int *)reader.read(sizeof(int) * header.cellNum) : NULL;
+    const int *netWeight = header.hasNetWeight ? (const int *)reader.read(sizeof(int) * header.netNum) : NULL;
+    if (netOffset == NULL || netPins == NULL || cellOffset == NULL || cellNets == NULL ||
+        (header.hasCellWeight && cellWeight == NULL) || (header.hasNetWeight && netWeight == NULL) ||
+        !_cellNames.load(reader) || !_netNames.load(reader) || !reader.atEnd() ||
+        netOffset[header.netNum] != header.pinNum || cellOffset[header.cellNum] != header.pinNum)
+    {
+        clear();
+        return false;
+    }
+
+    _netNum = header.netNum;
+    _cellNum = header.cellNum;
+    _pinNum = header.pinNum;
+    _maxPinNum = header.maxPinNum;
+    _maxNetWeightSum = header.maxNetWeightSum;
+    _totalWeight = header.totalWeight;
+    _netOffsetData = netOffset;
+    _netPinsData = netPins;
+    _cellOffsetData = cellOffset;
+    _cellNetsData = cellNets;
+    _cellWeightData = cellWeight;
+    _netWeightData = netWeight;
+    _mapping = mapping;
+    bFactor = header.bFactor;
+    sourceSize = header.sourceSize;
+    sourceTime = header.sourceTime;
+    return true;
+}
@@ -0,0 +1,236 @@
+#ifndef HYPERGRAPH_H
+#define HYPERGRAPH_H
+
+#include "mappedfile.h"
+#include "namepool.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// Read-only view of a contiguous run of ids, never owns or copies them
+class IdSpan
+{
+public:
+    IdSpan() : _begin(NULL), _end(NULL) {}
+    IdSpan(const int *begin, const int *end) : _begin(begin), _end(end) {}
+
+    const int *begin() const { return _begin; }
+    const int *end() const { return _end; }
+    int size() const { return (int)(_end - _begin); }
+    bool empty() const { return _begin == _end; }
+    int operator[](const int i) const { return _begin[i]; }
+
+private:
+    const int *_begin;
+    const int *_end;
+};
+
+// Read-only view of a coded run of ids: the varint length of the run, then
+// each id as the zigzag varint of its difference to the previous id (the
+// first to 0). Varints hold 7 bits per byte, low bits first, with the high
+// bit set on all but the last byte, so ids close to their predecessor take
+// one or two bytes instead of four. The run is walked forward only.
+class CodedSpan
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(const unsigned char *data, const int left) : _data(data), _left(left), _id(0)
+        {
+            if (_left > 0)
+                decode();
+        }
+        int operator*() const { return _id; }
+        Iterator &operator++()
+        {
+            if (--_left > 0)
+                decode();
+            return *this;
+        }
+        bool operator!=(const Iterator &other) const { return _left != other._left; }
+
+    private:
+        const unsigned char *_data; // next byte to decode
+        int _left;                  // ids left, the current one included
+        int _id;                    // current id
+
+        void decode()
+        {
+            const unsigned value = readVarint(_data);
+            _id += (int)((value >> 1) ^ (0u - (value & 1)));
+        }
+    };
+
+    CodedSpan() : _data(NULL), _size(0) {}
+    CodedSpan(const unsigned char *data) : _data(data), _size(readVarint(_data)) {}
+
+    Iterator begin() const { return Iterator(_data, _size); }
+    Iterator end() const { return Iterator(NULL, 0); }
+    int size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    // append the run of the ids [begin, end) to code
+    static void encode(const int *begin, const int *end, vector<unsigned char> &code)
+    {
+        writeVarint((unsigned)(end - begin), code);
+        int last = 0;
+        for (const int *id = begin; id != end; ++id)
+        {
+            const int delta = *id - last;
+            writeVarint(((unsigned)delta << 1) ^ (unsigned)(delta >> 31), code);
+            last = *id;
+        }
+    }
+
+private:
+    const unsigned char *_data; // first id, after the length
+    int _size;
+
+    static unsigned readVarint(const unsigned char *&data)
+    {
+        unsigned value = 0;
+        unsigned char byte;
+        int shift = 0;
+        do
+        {
+            byte = *data++;
+            value |= (unsigned)(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
+    static void writeVarint(unsigned value, vector<unsigned char> &code)
+    {
+        while (value >= 0x80)
+        {
+            code.push_back((unsigned char)(value | 0x80));
+            value >>= 7;
+        }
+        code.push_back((unsigned char)value);
+    }
+};
+
+// Compressed-sparse-row hypergraph: the pins of net i are
+// _netPins[_netOffset[i] .. _netOffset[i+1]) and the nets of cell i are
+// _cellNets[_cellOffset[i] .. _cellOffset[i+1]). Built once after parsing
+// and read-only afterwards, so any number of partitioners may share it.
+//
+// The arrays are read through plain pointers, which point either at the
+// owned vectors or, for a graph loaded from a binary cache, straight into
+// the mapped file (see save() and load()).
+//
+// A coded graph (buildCoded()) keeps both pin lists as CodedSpan runs with
+// 32-bit byte offsets instead, about half the bytes per pin when the ids of
+// a net are close together. Only getCodedCellList() and getCodedNetList()
+// read them; the plain lists, sizes and degrees are empty.
+class Hypergraph
+{
+public:
+    // constructor and destructor
+    Hypergraph() { clear(); }
+    ~Hypergraph() {}
+
+    // basic access methods
+    int getNetNum() const { return _netNum; }
+    int getCellNum() const { return _cellNum; }
+    int getPinNum() const { return _pinNum; }
+    int getMaxPinNum() const { return _maxPinNum; }
+    int getNetSize(const int netId) const { return _netOffsetData[netId + 1] - _netOffsetData[netId]; }
+    int getCellDegree(const int cellId) const { return _cellOffsetData[cellId + 1] - _cellOffsetData[cellId]; }
+    int getCellWeight(const int cellId) const { return (_cellWeightData == NULL) ? 1 : _cellWeightData[cellId]; }
+    int getTotalWeight() const { return (_cellWeightData == NULL) ? getCellNum() : _totalWeight; }
+    int getNetWeight(const int netId) const { return (_netWeightData == NULL) ? 1 : _netWeightData[netId]; }
+    int getMaxGain() const { return (_netWeightData == NULL) ? _maxPinNum : _maxNetWeightSum; }
+    bool hasCellWeight() const { return _cellWeightData != NULL; }
+    bool hasNetWeight() const { return _netWeightData != NULL; }
+    bool hasNames() const { return _cellNames.getSize() == getCellNum(); }
+    bool isMapped() const { return _mapping != NULL; }
+    bool isCoded() const { return !_netCodeOffset.empty(); }
+    size_t getMemoryUsage() const; // heap bytes of the owned arrays, names excluded
+    size_t getMappedSize() const { return (_mapping == NULL) ? 0 : _mapping->getSize(); }
+    const char *getNetName(const int netId) const { return _netNames.getName(netId); }
+    const char *getCellName(const int cellId) const { return _cellNames.getName(cellId); }
+    const NamePool &getCellNames() const { return _cellNames; }
+    const NamePool &getNetNames() const { return _netNames; }
+    IdSpan getCellList(const int netId) const
+    {
+        return IdSpan(_netPinsData + _netOffsetData[netId], _netPinsData + _netOffsetData[netId + 1]);
+    }
+    IdSpan getNetList(const int cellId) const
+    {
+        return IdSpan(_cellNetsData + _cellOffsetData[cellId], _cellNetsData + _cellOffsetData[cellId + 1]);
+    }
+    CodedSpan getCodedCellList(const int netId) const { return CodedSpan(_netCode.data() + _netCodeOffset[netId]); }
+    CodedSpan getCodedNetList(const int cellId) const { return CodedSpan(_cellCode.data() + _cellCodeOffset[cellId]); }
+
+    // build the cell->net side from net-major pins (takes over their storage)
+    void build(const int cellNum, vector<int> &netOffset, vector<int> &netPins);
+    // the same as a coded graph from the runs of the nets, net i at
+    // netCode[netCodeOffset[i]]; the plain net-major pins never exist and
+    // the cell side is coded in turn. False if a side outgrows 32-bit offsets
+    bool buildCoded(const int cellNum, vector<unsigned char> &netCode, vector<unsigned> &netCodeOffset);
+    void setCellWeight(vector<int> &cellWeight);
+    void setNetWeight(vector<int> &netWeight);
+    void setNames(NamePool &cellNames, NamePool &netNames);
+    void clear();
+
+    // contract(), renumber() and save() need a plain graph
+
+    // merge cells into clusters (cellMap[i] is the cluster of cell i, -1
+    // drops the cell); nets left with fewer than two clusters are dropped
+    // and nets left with the same clusters become one net of summed weight
+    void contract(const vector<int> &cellMap, const int clusterNum, Hypergraph &coarse) const;
+
+    // locality order of the cells, cellOrder[i] is the cell that becomes
+    // cell i: reverse Cuthill-McKee over cells sharing a net, so the pins of
+    // a net get nearby ids (nets larger than a limit are not followed)
+    void countLocalityOrder(vector<int> &cellOrder) const;
+    // copy with the cells in cellOrder and the nets sorted by their lowest
+    // new pin id; weights and names move with their cells and nets
+    void renumber(const vector<int> &cellOrder, Hypergraph &ordered) const;
+
+    // binary cache holding the arrays, names and the balance factor; the
+    // size and modification time of the source .dat file are recorded so
+    // that a cache older than its source can be told apart (times in ns)
+    bool save(const char *fileName, const double bFactor, const long long sourceSize, const long long sourceTime) const;
+    bool load(const char *fileName, double &bFactor, long long &sourceSize, long long &sourceTime);
+    static bool isCacheFile(const char *data, const size_t size);
+
+private:
+    Hypergraph(const Hypergraph &);
+    Hypergraph &operator=(const Hypergraph &);
+
+    int _netNum;             // number of nets
+    int _cellNum;            // number of cells
+    int _pinNum;             // number of pins
+    int _maxPinNum;          // max number of nets on a cell
+    int _maxNetWeightSum;    // max summed _netWeight of the nets on a cell, bounds any gain
+    int _totalWeight;        // sum of _cellWeight
+    vector<int> _netOffset;  // net i owns _netPins[_netOffset[i], _netOffset[i+1])
+    vector<int> _netPins;    // cell ids of all nets, net-major
+    vector<int> _cellOffset; // cell i owns _cellNets[_cellOffset[i], _cellOffset[i+1])
+    vector<int> _cellNets;   // net ids of all cells, cell-major
+    vector<int> _cellWeight; // weight of each cell, empty if all are 1
+    vector<int> _netWeight;  // weight of each net, empty if all are 1
+    NamePool _cellNames;     // cell names, empty for coarse levels
+    NamePool _netNames;      // net names, empty for coarse levels
+    vector<unsigned char> _netCode;  // coded pins of all nets, net-major (coded graphs only)
+    vector<unsigned> _netCodeOffset; // net i starts at _netCode[_netCodeOffset[i]]
+    vector<unsigned char> _cellCode; // coded nets of all cells, cell-major (coded graphs only)
+    vector<unsigned> _cellCodeOffset; // cell i starts at _cellCode[_cellCodeOffset[i]]
+
+    // the arrays above, or the same arrays in _mapping; weights are NULL if all are 1
+    const int *_netOffsetData;
+    const int *_netPinsData;
+    const int *_cellOffsetData;
+    const int *_cellNetsData;
+    const int *_cellWeightData;
+    const int *_netWeightData;
+    shared_ptr<MappedFile> _mapping; // cache file the arrays are read from, NULL if owned
+
+    void bindData();
+};
+
+#endif // HYPERGRAPH_H
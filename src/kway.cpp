@@ -0,0 +1,209 @@
+#include "kway.h"
+#include "hypergraph.h"
+#include "kwayfm.h"
+#include "multilevel.h"
+#include "partitioner.h"
+#include "threadpool.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+using namespace std;
+
+void KWayPartitioner::bisectTask(const Task &task, const double bFactor, Task &lower, Task &upper)
+{
+    Partitioner partitioner(task.graph, bFactor);
+    partitioner.copyOptions(_partitioner);
+    partitioner.setVerbose(false);
+    partitioner.setThreadNum(1); // the bisections already run in parallel
+    if (_multilevel)
+    {
+        Multilevel ml(partitioner);
+        ml.setSeed(_seed + task.firstBlock);
+        ml.setVerbose(false);
+        ml.partition();
+    }
+    else
+        partitioner.partition();
+
+    const int cellNum = task.graph->getCellNum();
+    const int half = task.blockNum / 2;
+    if (half == 1)
+    {
+        for (int i = 0; i < cellNum; i++)
+        {
+            _block[task.cells[i]] = task.firstBlock + partitioner.getPart(i);
+        }
+        return;
+    }
+
+    // induce one sub-hypergraph per side, cut nets keep the pins on that side
+    Task *side[2] = {&lower, &upper};
+    vector<int> cellMap[2];
+    for (int s = 0; s < 2; s++)
+    {
+        side[s]->firstBlock = task.firstBlock + s * half;
+        side[s]->blockNum = half;
+        cellMap[s].assign(cellNum, -1);
+    }
+    for (int i = 0; i < cellNum; i++)
+    {
+        const bool s = partitioner.getPart(i);
+        cellMap[s][i] = side[s]->cells.size();
+        side[s]->cells.push_back(task.cells[i]);
+    }
+    for (int s = 0; s < 2; s++)
+    {
+        shared_ptr<Hypergraph> sub(new Hypergraph());
+        task.graph->contract(cellMap[s], side[s]->cells.size(), *sub);
+        side[s]->graph = sub;
+    }
+}
+
+void KWayPartitioner::bisect()
+{
+    // split the balance window so that the levels together stay within it
+    int levelNum = 0;
+    while ((1 << levelNum) < _k)
+        ++levelNum;
+    const double bFactor = pow(1 + _partitioner.getBFactor(), 1.0 / levelNum) - 1;
+
+    vector<Task> level(1);
+    level[0].graph = _graph;
+    level[0].firstBlock = 0;
+    level[0].blockNum = _k;
+    level[0].cells.resize(_graph->getCellNum());
+    for (int i = 0; i < _graph->getCellNum(); i++)
+        level[0].cells[i] = i;
+
+    ThreadPool pool(_threadNum);
+    while (!level.empty())
+    {
+        vector<Task> next(2 * level.size());
+        for (size_t i = 0; i < level.size(); i++)
+        {
+            pool.submit([this, i, bFactor, &level, &next]() {
+                bisectTask(level[i], bFactor, next[2 * i], next[2 * i + 1]);
+            });
+        }
+        pool.wait();
+
+        level.clear();
+        for (size_t i = 0; i < next.size(); i++)
+        {
+            if (next[i].blockNum > 1)
+                level.push_back(next[i]);
+        }
+    }
+
+    countBlockSize();
+    countCutsize();
+}
+
+void KWayPartitioner::refine(const KWayRefiner::Objective objective)
+{
+    KWayRefiner refiner(*_graph, _k, _partitioner.getBFactor(), _block);
+    refiner.setObjective(objective);
+    refiner.setStallLimit(_partitioner.getStallLimit());
+    refiner.setDropLimit(_partitioner.getDropLimit());
+    refiner.setMaxPass(_partitioner.getMaxPass());
+    if (_partitioner.hasDeadline())
+        refiner.setDeadline(_partitioner.getDeadline());
+    refiner.setVerbose(_partitioner.getVerbose());
+    refiner.refine();
+
+    countBlockSize();
+    countCutsize();
+}
+
+void KWayPartitioner::countCutsize()
+{
+    vector<int> lastNet(_k, -1); // last net a block was seen on
+    _cutSize = 0;
+    _connectivity = 0;
+    for (int i = 0; i < _graph->getNetNum(); i++)
+    {
+        int lambda = 0;
+        IdSpan cl = _graph->getCellList(i);
+        for (int j = 0; j < cl.size(); j++)
+        {
+            const int block = _block[cl[j]];
+            if (lastNet[block] != i)
+            {
+                lastNet[block] = i;
+                ++lambda;
+            }
+        }
+        if (lambda > 1)
+        {
+            _cutSize += _graph->getNetWeight(i);
+            _connectivity += _graph->getNetWeight(i) * (lambda - 1);
+        }
+    }
+}
+
+void KWayPartitioner::countBlockSize()
+{
+    _blockSize.assign(_k, 0);
+    for (int i = 0; i < _graph->getCellNum(); i++)
+    {
+        _blockSize[_block[i]] += _graph->getCellWeight(i);
+    }
+}
+
+void KWayPartitioner::printSummary() const
+{
+    cout << endl;
+    cout << "==================== Summary ====================" << endl;
+    cout << " Cutsize: " << _cutSize << endl;
+    cout << " Connectivity (lambda - 1): " << _connectivity << endl;
+    cout << " Total cell number: " << _graph->getCellNum() << endl;
+    cout << " Total net number:  " << _graph->getNetNum() << endl;
+    vector<int> cellNum(_k, 0);
+    for (size_t i = 0; i < _block.size(); i++)
+    {
+        ++cellNum[_block[i]];
+    }
+    for (int i = 0; i < _k; i++)
+    {
+        cout << " Cell Number of block " << i + 1 << ": " << cellNum[i] << " (weight " << _blockSize[i] << ")"
+             << endl;
+    }
+    cout << "=================================================" << endl;
+    cout << endl;
+    return;
+}
+
+void KWayPartitioner::writeResult(fstream &outFile)
+{
+    // group the cells by block, keeping cell order inside each block
+    const int cellNum = _graph->getCellNum();
+    vector<int> offset(_k + 1, 0);
+    for (int i = 0; i < cellNum; i++)
+    {
+        ++offset[_block[i] + 1];
+    }
+    for (int b = 0; b < _k; b++)
+    {
+        offset[b + 1] += offset[b];
+    }
+    vector<int> order(cellNum);
+    vector<int> fill(offset.begin(), offset.end() - 1);
+    for (int i = 0; i < cellNum; i++)
+    {
+        order[fill[_block[i]]++] = i;
+    }
+
+    outFile << "Cutsize = " << _cutSize << '\n';
+    for (int b = 0; b < _k; b++)
+    {
+        outFile << "G" << b + 1 << " " << offset[b + 1] - offset[b] << '\n';
+        for (int i = offset[b]; i < offset[b + 1]; i++)
+        {
+            outFile << _graph->getCellName(order[i]) << " ";
+        }
+        outFile << ";\n";
+    }
+    return;
+}
@@ -0,0 +1,73 @@
+#ifndef KWAY_H
+#define KWAY_H
+
+#include "hypergraph.h"
+#include "kwayfm.h"
+#include "partitioner.h"
+#include <fstream>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// k-way partitioning by recursive bisection. Every bisection runs the 2-way
+// engine on a sub-hypergraph induced by one side of its parent; cut nets
+// are split, keeping their pins on that side. All bisections of a level
+// run concurrently on a thread pool. k must be a power of two. The result
+// can then be improved across all blocks at once by KWayRefiner.
+class KWayPartitioner
+{
+public:
+    // constructor and destructor
+    KWayPartitioner(Partitioner &partitioner, const int k)
+        : _partitioner(partitioner), _graph(partitioner.getSharedGraph()), _k(k), _threadNum(1), _seed(0),
+          _multilevel(false), _cutSize(0), _connectivity(0), _block(_graph->getCellNum(), 0), _blockSize(k, 0) {}
+    ~KWayPartitioner() {}
+
+    // basic access methods
+    int getK() const { return _k; }
+    int getCutSize() const { return _cutSize; }
+    int getConnectivity() const { return _connectivity; }
+    int getBlock(const int cellId) const { return _block[cellId]; }
+    int getBlockSize(const int block) const { return _blockSize[block]; }
+    static bool isValidK(const int k) { return k >= 2 && (k & (k - 1)) == 0; }
+
+    // set functions
+    void setThreadNum(const int threadNum) { _threadNum = threadNum; }
+    void setSeed(const unsigned seed) { _seed = seed; }
+    void setMultilevel(const bool multilevel) { _multilevel = multilevel; }
+
+    // modify methods
+    void bisect();
+    void refine(const KWayRefiner::Objective objective);
+    void countCutsize();
+    void countBlockSize();
+
+    // member functions about reporting
+    void printSummary() const;
+    void writeResult(fstream &outFile);
+
+private:
+    // one pending bisection: a sub-hypergraph whose cell i is _block cell cells[i]
+    struct Task
+    {
+        shared_ptr<const Hypergraph> graph;
+        vector<int> cells;
+        int firstBlock;
+        int blockNum;
+    };
+
+    Partitioner &_partitioner;          // parsed circuit and 2-way options
+    shared_ptr<const Hypergraph> _graph; // the whole circuit
+    int _k;                             // number of blocks
+    int _threadNum;                     // number of worker threads
+    unsigned _seed;                     // seed of the multilevel matching
+    bool _multilevel;                   // bisect with the multilevel V-cycle
+    int _cutSize;                       // number of nets spanning several blocks
+    int _connectivity;                  // sum over nets of (blocks spanned - 1)
+    vector<int> _block;                 // block of each cell
+    vector<int> _blockSize;             // cell weight of each block
+
+    void bisectTask(const Task &task, const double bFactor, Task &lower, Task &upper);
+};
+
+#endif // KWAY_H
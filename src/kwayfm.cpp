@@ -0,0 +1,341 @@
+#include "kwayfm.h"
+#include "bucket.h"
+#include "hypergraph.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// a pass reads the clock once every this many moves
+static const int DEADLINE_CHECK_MOVES = 256;
+
+KWayRefiner::KWayRefiner(const Hypergraph &graph, const int k, const double bFactor, vector<int> &block)
+    : _graph(graph), _k(k), _block(block), _objective(CONNECTIVITY), _stallLimit(0), _dropLimit(0),
+      _maxPass(150), _hasDeadline(false), _timeUp(false), _verbose(false), _objValue(0), _passNum(0), _moveNum(0)
+{
+    const double avg = (double)_graph.getTotalWeight() / _k;
+    _lb = (int)ceil((1 - bFactor) * avg);
+    _ub = (int)floor((1 + bFactor) * avg);
+
+    const int netNum = _graph.getNetNum();
+    const int cellNum = _graph.getCellNum();
+    _phiOffset.resize(netNum + 1);
+    _phiOffset[0] = 0;
+    for (int i = 0; i < netNum; i++)
+    {
+        _phiOffset[i + 1] = _phiOffset[i] + min(_k, _graph.getNetSize(i));
+    }
+    _phiNum.assign(netNum, 0);
+    _phiBlock.resize(_phiOffset[netNum]);
+    _phiCount.resize(_phiOffset[netNum]);
+
+    _gain.assign(cellNum, 0);
+    _target.assign(cellNum, -1);
+    _lock.assign(cellNum, 0);
+    _dirtyStamp.assign(cellNum, -1);
+    _node.reserve(cellNum);
+    for (int i = 0; i < cellNum; i++)
+        _node.push_back(Node(i));
+    _bList.resize(_k);
+    _adj.assign(_k, 0);
+    _bonus.assign(_k, 0);
+}
+
+int KWayRefiner::getPhi(const int netId, const int block) const
+{
+    for (int i = _phiOffset[netId], end = i + _phiNum[netId]; i < end; i++)
+    {
+        if (_phiBlock[i] == block)
+            return _phiCount[i];
+    }
+    return 0;
+}
+
+void KWayRefiner::incPhi(const int netId, const int block)
+{
+    const int start = _phiOffset[netId];
+    const int end = start + _phiNum[netId];
+    for (int i = start; i < end; i++)
+    {
+        if (_phiBlock[i] == block)
+        {
+            ++_phiCount[i];
+            return;
+        }
+    }
+    _phiBlock[end] = block;
+    _phiCount[end] = 1;
+    ++_phiNum[netId];
+}
+
+void KWayRefiner::decPhi(const int netId, const int block)
+{
+    const int start = _phiOffset[netId];
+    const int last = start + _phiNum[netId] - 1;
+    for (int i = start; i <= last; i++)
+    {
+        if (_phiBlock[i] == block)
+        {
+            // drop the slot by moving the last one into it
+            if (--_phiCount[i] == 0)
+            {
+                _phiBlock[i] = _phiBlock[last];
+                _phiCount[i] = _phiCount[last];
+                --_phiNum[netId];
+            }
+            return;
+        }
+    }
+}
+
+void KWayRefiner::countPhi()
+{
+    _blockWeight.assign(_k, 0);
+    for (int i = 0; i < _graph.getCellNum(); i++)
+    {
+        _blockWeight[_block[i]] += _graph.getCellWeight(i);
+    }
+    for (int i = 0; i < _graph.getNetNum(); i++)
+    {
+        _phiNum[i] = 0;
+        IdSpan cl = _graph.getCellList(i);
+        for (int j = 0; j < cl.size(); j++)
+        {
+            incPhi(i, _block[cl[j]]);
+        }
+    }
+}
+
+int KWayRefiner::countObjective() const
+{
+    int value = 0;
+    for (int i = 0; i < _graph.getNetNum(); i++)
+    {
+        if (_phiNum[i] > 1)
+            value += _graph.getNetWeight(i) * ((_objective == CUT_NET) ? 1 : _phiNum[i] - 1);
+    }
+    return value;
+}
+
+void KWayRefiner::computeGain(const int cellId)
+{
+    const int from = _block[cellId];
+    int base = 0; // gain shared by every target
+    IdSpan nl = _graph.getNetList(cellId);
+    for (int i = 0; i < nl.size(); i++)
+    {
+        const int netId = nl[i];
+        const int size = _graph.getNetSize(netId);
+        const int w = _graph.getNetWeight(netId);
+        const int phiFrom = getPhi(netId, from);
+        if (_objective == CONNECTIVITY)
+        {
+            // leaving 'from' helps if alone there, entering a new block costs w
+            if (phiFrom == 1)
+                base += w;
+            base -= w;
+        }
+        else if (phiFrom == size)
+            base -= w; // any move cuts this net
+        for (int j = _phiOffset[netId], end = j + _phiNum[netId]; j < end; j++)
+        {
+            const int to = _phiBlock[j];
+            if (to == from)
+                continue;
+            if (_adj[to] == 0 && _bonus[to] == 0)
+                _touched.push_back(to);
+            _adj[to] += w; // no new block for this net
+            if (_objective == CUT_NET && phiFrom == 1 && _phiCount[j] == size - 1)
+                _bonus[to] += w; // the move uncuts this net
+        }
+    }
+
+    // best target among the adjacent blocks, the lighter block on ties
+    int bestGain = INT_MIN;
+    int bestTarget = -1;
+    for (size_t i = 0; i < _touched.size(); i++)
+    {
+        const int to = _touched[i];
+        const int gain = base + ((_objective == CONNECTIVITY) ? _adj[to] : _bonus[to]);
+        if (gain > bestGain || (gain == bestGain && _blockWeight[to] < _blockWeight[bestTarget]))
+        {
+            bestGain = gain;
+            bestTarget = to;
+        }
+        _adj[to] = 0;
+        _bonus[to] = 0;
+    }
+    _touched.clear();
+
+    _gain[cellId] = (bestTarget >= 0) ? bestGain : 0;
+    _target[cellId] = bestTarget;
+}
+
+bool KWayRefiner::critical(const int netId, const int count) const
+{
+    // gains only depend on block pin counts reaching these values
+    if (_objective == CONNECTIVITY)
+        return count <= 1;
+    const int size = _graph.getNetSize(netId);
+    return count == 1 || count >= size - 1;
+}
+
+void KWayRefiner::moveCell(const int cellId, const int to, const bool update)
+{
+    const int from = _block[cellId];
+    const int weight = _graph.getCellWeight(cellId);
+    _block[cellId] = to;
+    _blockWeight[from] -= weight;
+    _blockWeight[to] += weight;
+
+    const int stamp = _moveStack.size();
+    IdSpan nl = _graph.getNetList(cellId);
+    for (int i = 0; i < nl.size(); i++)
+    {
+        const int netId = nl[i];
+        const int phiFrom = getPhi(netId, from);
+        const int phiTo = getPhi(netId, to);
+        decPhi(netId, from);
+        incPhi(netId, to);
+        if (!update)
+            continue;
+
+        // collect the unlocked cells whose gain may have changed
+        if (critical(netId, phiFrom) || critical(netId, phiFrom - 1) ||
+            critical(netId, phiTo) || critical(netId, phiTo + 1))
+        {
+            IdSpan cl = _graph.getCellList(netId);
+            for (int j = 0; j < cl.size(); j++)
+            {
+                const int u = cl[j];
+                if (!_lock[u] && _dirtyStamp[u] != stamp)
+                {
+                    _dirtyStamp[u] = stamp;
+                    _dirty.push_back(u);
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < _dirty.size(); i++)
+    {
+        const int u = _dirty[i];
+        if (_target[u] >= 0)
+            _bList[_target[u]].remove(&_node[u], _gain[u]);
+        computeGain(u);
+        if (_target[u] >= 0)
+            _bList[_target[u]].insert(&_node[u], _gain[u]);
+    }
+    _dirty.clear();
+}
+
+int KWayRefiner::pass()
+{
+    const int cellNum = _graph.getCellNum();
+    int maxPartialSum = 0;
+    int maxPartialSumID = -1;
+    int partialSum = 0;
+
+    // create initial bucket lists
+    for (int b = 0; b < _k; b++)
+        _bList[b].init(_graph.getMaxGain(), cellNum / _k + 1);
+    for (int i = 0; i < cellNum; i++)
+    {
+        _lock[i] = 0;
+        _dirtyStamp[i] = -1;
+        computeGain(i);
+        if (_target[i] >= 0)
+            _bList[_target[i]].insert(&_node[i], _gain[i]);
+    }
+    _moveStack.clear();
+    _moveFrom.clear();
+
+    for (int itt = 0; itt < cellNum; itt++)
+    {
+        // stop mid-pass at the deadline, the rollback keeps the best prefix
+        if (itt % DEADLINE_CHECK_MOVES == 0 && isTimeUp())
+            break;
+
+        // best head among the target blocks that can take it
+        Node *best = NULL;
+        for (int b = 0; b < _k; b++)
+        {
+            Node *node = _bList[b].getMaxGainNode();
+            if (node == NULL)
+                continue;
+            const int u = node->getId();
+            const int weight = _graph.getCellWeight(u);
+            if (_blockWeight[b] + weight > _ub || _blockWeight[_block[u]] - weight < _lb)
+                continue;
+            if (best == NULL || _gain[u] > _gain[best->getId()])
+                best = node;
+        }
+        if (best == NULL)
+            break;
+
+        const int u = best->getId();
+        const int to = _target[u];
+        _bList[to].remove(best, _gain[u]);
+        _lock[u] = 1;
+        partialSum += _gain[u];
+        _moveFrom.push_back(_block[u]);
+        _moveStack.push_back(u);
+        moveCell(u, to, true);
+
+        if (partialSum > maxPartialSum)
+        {
+            maxPartialSum = partialSum;
+            maxPartialSumID = itt;
+        }
+
+        // early stop once the partial sum curve stops improving
+        if (_stallLimit > 0 && itt - maxPartialSumID >= _stallLimit)
+            break;
+        if (_dropLimit > 0 && maxPartialSum - partialSum >= _dropLimit)
+            break;
+    }
+    _moveNum = _moveStack.size();
+
+    // move back the moves after the best prefix
+    for (int i = _moveStack.size() - 1; i > maxPartialSumID; i--)
+    {
+        moveCell(_moveStack[i], _moveFrom[i], false);
+    }
+    _objValue -= maxPartialSum;
+    return maxPartialSum;
+}
+
+bool KWayRefiner::isTimeUp()
+{
+    if (!_timeUp && _hasDeadline && chrono::steady_clock::now() >= _deadline)
+    {
+        _timeUp = true;
+        if (_verbose)
+            cout << "Time limit reached, keeping the best k-way partition so far" << endl;
+    }
+    return _timeUp;
+}
+
+int KWayRefiner::refine()
+{
+    countPhi();
+    _objValue = countObjective();
+    const int initValue = _objValue;
+
+    int gain = 1;
+    for (_passNum = 0; _passNum < _maxPass && gain > 0 && !isTimeUp();)
+    {
+        gain = pass();
+        ++_passNum;
+        if (_verbose)
+        {
+            cout << "****k-way pass: " << _passNum << "****" << endl;
+            cout << "gain: " << gain << ", moves: " << _moveNum << endl;
+            cout << ((_objective == CUT_NET) ? "CutSize is: " : "Connectivity is: ") << _objValue << endl
+                 << endl;
+        }
+    }
+    return initValue - _objValue;
+}
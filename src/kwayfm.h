@@ -0,0 +1,107 @@
+#ifndef KWAYFM_H
+#define KWAYFM_H
+
+#include "bucket.h"
+#include "cell.h"
+#include "hypergraph.h"
+#include <chrono>
+#include <vector>
+using namespace std;
+
+// Direct k-way FM refinement of an existing block assignment. Generalizes
+// FM() from two sides to k blocks:
+//  - per-net pin counts are kept only for the blocks a net touches, in a
+//    flat array with min(k, net size) slots per net, so memory stays
+//    O(pins) even for k = 64;
+//  - every unlocked boundary cell sits in the bucket list of its best
+//    target block, so selection compares at most k bucket heads;
+//  - a move is legal if the source block stays above and the target block
+//    below the k-way balance bounds (1 -/+ b) * total / k;
+//  - at the deadline a pass stops within a few hundred moves and rolls
+//    back to its best prefix, and no further pass starts.
+// Supports the cut-net and the connectivity (lambda - 1) objectives.
+class KWayRefiner
+{
+public:
+    enum Objective
+    {
+        CUT_NET,
+        CONNECTIVITY
+    };
+
+    // constructor and destructor
+    KWayRefiner(const Hypergraph &graph, const int k, const double bFactor, vector<int> &block);
+    ~KWayRefiner() {}
+
+    // basic access methods
+    int getObjectiveValue() const { return _objValue; }
+    int getPassNum() const { return _passNum; }
+    int getMoveNum() const { return _moveNum; }
+
+    // set functions
+    void setObjective(const Objective objective) { _objective = objective; }
+    void setStallLimit(const int stallLimit) { _stallLimit = stallLimit; }
+    void setDropLimit(const int dropLimit) { _dropLimit = dropLimit; }
+    void setMaxPass(const int maxPass) { _maxPass = maxPass; }
+    void setDeadline(const chrono::steady_clock::time_point &deadline)
+    {
+        _deadline = deadline;
+        _hasDeadline = true;
+    }
+    void setVerbose(const bool verbose) { _verbose = verbose; }
+
+    // modify methods
+    int refine(); // run passes until one does not improve, returns the total improvement
+    int countObjective() const;
+
+private:
+    const Hypergraph &_graph; // circuit
+    const int _k;             // number of blocks
+    vector<int> &_block;      // block of each cell, refined in place
+    Objective _objective;     // quantity to minimize
+    int _lb, _ub;             // allowed block weight range
+    int _stallLimit;          // end a pass after this many moves without a new max partial sum (0: off)
+    int _dropLimit;           // end a pass once the partial sum is this far below the max (0: off)
+    int _maxPass;             // pass limit of refine()
+    bool _hasDeadline;        // _deadline is set
+    bool _timeUp;             // _deadline has passed
+    chrono::steady_clock::time_point _deadline; // no pass moves a cell after this
+    bool _verbose;            // print the progress of each pass
+    int _objValue;            // current objective value
+    int _passNum;             // passes run by refine()
+    int _moveNum;             // moves made by the last pass
+
+    vector<int> _blockWeight; // cell weight of each block
+
+    // pins of net i per block: _phiBlock/_phiCount[_phiOffset[i] .. + _phiNum[i])
+    vector<int> _phiOffset;
+    vector<int> _phiNum;
+    vector<int> _phiBlock;
+    vector<int> _phiCount;
+
+    vector<int> _gain;        // best move gain of each cell
+    vector<int> _target;      // block of the best move, -1 if the cell is interior
+    vector<char> _lock;       // whether the cell moved in this pass
+    vector<Node> _node;       // bucket list node of each cell
+    vector<BucketList> _bList; // bucket list of each target block
+
+    vector<int> _moveStack;   // cells moved in this pass
+    vector<int> _moveFrom;    // source block of each move
+    vector<int> _dirty;       // cells whose gain needs recomputing
+    vector<int> _dirtyStamp;  // move number a cell was last marked dirty at
+    vector<int> _adj;         // scratch, per block, for computeGain
+    vector<int> _bonus;       // scratch, per block, for computeGain
+    vector<int> _touched;     // scratch, blocks set in _adj/_bonus
+
+    int getPhi(const int netId, const int block) const;
+    void incPhi(const int netId, const int block);
+    void decPhi(const int netId, const int block);
+    void countPhi();
+    void computeGain(const int cellId);
+    void moveCell(const int cellId, const int to, const bool update);
+    bool critical(const int netId, const int count) const;
+    bool isTimeUp();
+    int pass();
+};
+
+#endif // KWAYFM_H
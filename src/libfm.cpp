@@ -0,0 +1,244 @@
+#include "libfm.h"
+#include "hypergraph.h"
+#include "multilevel.h"
+#include "multistart.h"
+#include "partitioner.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+shared_ptr<const Hypergraph> buildHypergraph(const int cellNum, vector<int> &netOffset, vector<int> &netPins,
+                                             vector<int> &cellWeight, vector<int> &netWeight)
+{
+    // reject what the CSR build would read out of bounds
+    if (cellNum < 0 || netOffset.empty() || netOffset[0] != 0 || netOffset.back() != (int)netPins.size())
+        return shared_ptr<const Hypergraph>();
+    const int netNum = (int)netOffset.size() - 1;
+    for (int i = 0; i < netNum; i++)
+    {
+        if (netOffset[i] > netOffset[i + 1])
+            return shared_ptr<const Hypergraph>();
+    }
+    for (size_t i = 0; i < netPins.size(); i++)
+    {
+        if (netPins[i] < 0 || netPins[i] >= cellNum)
+            return shared_ptr<const Hypergraph>();
+    }
+    if ((!cellWeight.empty() && (int)cellWeight.size() != cellNum) ||
+        (!netWeight.empty() && (int)netWeight.size() != netNum))
+        return shared_ptr<const Hypergraph>();
+    for (size_t i = 0; i < cellWeight.size(); i++)
+    {
+        if (cellWeight[i] < 0)
+            return shared_ptr<const Hypergraph>();
+    }
+    for (size_t i = 0; i < netWeight.size(); i++)
+    {
+        if (netWeight[i] < 1)
+            return shared_ptr<const Hypergraph>();
+    }
+
+    shared_ptr<Hypergraph> graph(new Hypergraph());
+    graph->build(cellNum, netOffset, netPins);
+    if (!cellWeight.empty())
+        graph->setCellWeight(cellWeight);
+    if (!netWeight.empty())
+        graph->setNetWeight(netWeight);
+    return graph;
+}
+
+bool FmEngine::partition(shared_ptr<const Hypergraph> graph, const FmOptions &options, FmResult &result,
+                         const vector<signed char> *fixed)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    _partitioner.reset(graph, options.bFactor);
+    _partitioner.setMaxPass(options.maxPass);
+    _partitioner.setRefiner(options.refiner);
+    _partitioner.setStallLimit(options.stallLimit);
+    _partitioner.setDropLimit(options.dropLimit);
+    _partitioner.setThreadNum(options.startNum > 0 ? 1 : options.threadNum);
+    if (options.timeLimit > 0)
+        _partitioner.setDeadline(start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                             chrono::duration<double>(options.timeLimit)));
+
+    if (options.startNum > 0)
+    {
+        MultiStart ms(_partitioner);
+        ms.setStartNum(options.startNum);
+        ms.setThreadNum(options.threadNum);
+        ms.setSeed(options.seed);
+        ms.setMultilevel(options.multilevel);
+        ms.partition();
+    }
+    else if (options.multilevel)
+    {
+        Multilevel ml(_partitioner);
+        ml.setSeed(options.seed);
+        ml.partition();
+    }
+    else
+        _partitioner.partition();
+    if (fixed != NULL && !applyFixed(*fixed))
+        return false;
+
+    const int cellNum = graph->getCellNum();
+    result.part.resize(cellNum);
+    for (int i = 0; i < cellNum; i++)
+    {
+        result.part[i] = _partitioner.getPart(i);
+    }
+    result.cutSize = _partitioner.getCutSize();
+    result.partSize[0] = _partitioner.getPartSize(0);
+    result.partSize[1] = _partitioner.getPartSize(1);
+    _partitioner.countBalanceBound();
+    result.balanced = true;
+    for (int i = 0; i < 2; i++)
+    {
+        if (result.partSize[i] < _partitioner.getLowerBound() || result.partSize[i] > _partitioner.getUpperBound())
+            result.balanced = false;
+    }
+    result.time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.stats = _partitioner.getStats();
+    return true;
+}
+
+bool FmEngine::applyFixed(const vector<signed char> &fixed)
+{
+    const Hypergraph &graph = _partitioner.getGraph();
+    const int cellNum = graph.getCellNum();
+    if ((int)fixed.size() != cellNum)
+        return false;
+    vector<int> freeCells;
+    for (int i = 0; i < cellNum; i++)
+    {
+        if (fixed[i] < 0)
+            freeCells.push_back(i);
+        else
+            _partitioner.setPart(i, fixed[i]);
+    }
+    _partitioner.countNetPartCount();
+    _partitioner.countPartsize();
+    _partitioner.countCutsize();
+    _partitioner.countGain();
+
+    // pinning may overfill a side, FM alone cannot bring it back
+    _partitioner.rebalance(&freeCells);
+
+    // FM over the free cells only, the pinned ones stay locked
+    _partitioner.countMaxPinNum();
+    _partitioner.lockAll();
+    _partitioner.refineRegion(freeCells);
+    return true;
+}
+
+bool FmEngine::writeResult(const char *outName)
+{
+    if (!_partitioner.getGraph().hasNames())
+        return false;
+    fstream outFile(outName, ios::out);
+    if (!outFile)
+        return false;
+    return _partitioner.writeResult(outFile);
+}
+
+bool FmEngine::partitionFile(const char *inName, const char *outName, const FmOptions &options,
+                             FmResult &result, string &error)
+{
+    // parsed straight into the reused partitioner, which keeps its capacity
+    if (!_partitioner.parseFile(inName))
+    {
+        error = "cannot open the input file";
+        return false;
+    }
+    FmOptions fileOptions = options;
+    fileOptions.bFactor = _partitioner.getBFactor();
+    partition(_partitioner.getSharedGraph(), fileOptions, result);
+
+    if (outName != NULL && !writeResult(outName))
+    {
+        error = "cannot open the output file";
+        return false;
+    }
+    return true;
+}
+
+bool FmBatch::readManifest(const char *fileName)
+{
+    fstream inFile(fileName, ios::in);
+    if (!inFile)
+        return false;
+    string line;
+    while (getline(inFile, line))
+    {
+        const size_t comment = line.find('#');
+        if (comment != string::npos)
+            line.erase(comment);
+        istringstream tokens(line);
+        string inName, outName;
+        if (tokens >> inName)
+        {
+            tokens >> outName;
+            addJob(inName, outName);
+        }
+    }
+    return true;
+}
+
+void FmBatch::addJob(const string &inName, const string &outName)
+{
+    FmJob job;
+    job.inName = inName;
+    job.outName = outName;
+    job.done = false;
+    job.cellNum = 0;
+    job.cutSize = 0;
+    job.time = 0;
+    _jobs.push_back(job);
+}
+
+void FmBatch::run()
+{
+    const int threadNum = max(1, min(_threadNum, (int)_jobs.size()));
+    vector<unique_ptr<FmEngine> > engines;
+    vector<FmEngine *> idle;
+    for (int i = 0; i < threadNum; i++)
+    {
+        engines.push_back(unique_ptr<FmEngine>(new FmEngine()));
+        idle.push_back(engines.back().get());
+    }
+    mutex idleMutex;
+
+    ThreadPool pool(threadNum);
+    for (size_t i = 0; i < _jobs.size(); i++)
+    {
+        pool.submit([this, i, &idle, &idleMutex]() {
+            // at most threadNum jobs run at once, so an idle engine is always left
+            FmEngine *engine;
+            {
+                lock_guard<mutex> lock(idleMutex);
+                engine = idle.back();
+                idle.pop_back();
+            }
+
+            FmJob &job = _jobs[i];
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            FmResult result;
+            job.done = engine->partitionFile(job.inName.c_str(), job.outName.empty() ? NULL : job.outName.c_str(),
+                                             _options, result, job.error);
+            job.cellNum = result.part.size();
+            job.cutSize = result.cutSize;
+            job.time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            lock_guard<mutex> lock(idleMutex);
+            idle.push_back(engine);
+        });
+    }
+    pool.wait();
+}
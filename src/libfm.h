@@ -0,0 +1,131 @@
+#ifndef LIBFM_H
+#define LIBFM_H
+
+#include "hypergraph.h"
+#include "partitioner.h"
+#include "stats.h"
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Embedding API of lib/libfm.a: build a circuit from in-memory arrays,
+// partition it and read back the sides and statistics, without a process
+// or text files per job. FmEngine keeps its arrays between jobs, FmBatch
+// runs a manifest of .dat files on a thread pool.
+
+// options of one partitioning job
+struct FmOptions
+{
+    double bFactor;   // balance factor of in-memory circuits (.dat files carry their own)
+    unsigned seed;    // seed of the multilevel matching order and of the random starts
+    int maxPass;      // FM passes (or label propagation rounds) per refinement
+    int stallLimit;   // end a pass after this many moves without a new max partial sum (0: off)
+    int dropLimit;    // end a pass once the partial sum is this far below the max (0: off)
+    bool multilevel;  // multilevel V-cycle instead of flat FM
+    int startNum;     // keep the best of this many randomized searches (0: one deterministic run)
+    int threadNum;    // threads of one job
+    double timeLimit; // seconds per job, the best partition so far is kept (0: none)
+    Partitioner::Refiner refiner; // engine of every refinement
+
+    FmOptions() : bFactor(0.1), seed(0), maxPass(150), stallLimit(0), dropLimit(0), multilevel(false),
+                  startNum(0), threadNum(1), timeLimit(0),
+                  refiner(Partitioner::FM_PASSES) {}
+};
+
+// outcome of one job
+struct FmResult
+{
+    vector<char> part; // side (0 or 1) of each cell
+    int cutSize;       // summed weight of the cut nets
+    int partSize[2];   // cell weight of each side
+    bool balanced;     // both sides are within the balance bounds
+    double time;       // wall time of the partitioning in seconds
+    Stats stats;       // counters, phase times and passes
+
+    FmResult() : cutSize(0), balanced(false), time(0)
+    {
+        partSize[0] = 0;
+        partSize[1] = 0;
+    }
+};
+
+// Build a circuit of cellNum cells from net-major pins: the pins of net i
+// are netPins[netOffset[i], netOffset[i + 1]). Weights may be empty (all 1).
+// The vectors are taken over and left empty. Returns NULL if an offset,
+// cell id or weight is out of range.
+shared_ptr<const Hypergraph> buildHypergraph(const int cellNum, vector<int> &netOffset, vector<int> &netPins,
+                                             vector<int> &cellWeight, vector<int> &netWeight);
+
+// Reusable partitioning context. Its partitioner keeps the capacity of the
+// cell, net, bucket and move log arrays of the previous job, so a stream of
+// jobs of similar size does not reallocate them.
+class FmEngine
+{
+public:
+    // constructor and destructor
+    FmEngine() { _partitioner.setVerbose(false); }
+    ~FmEngine() {}
+
+    // modify methods
+    // fixed, if given, holds 0 or 1 for a cell pinned to that side and -1
+    // for a free cell; the other cells are then refined around the pinned
+    // ones, and result.balanced tells whether the bounds could still be met.
+    // False, with result untouched, if fixed does not hold one entry per cell
+    bool partition(shared_ptr<const Hypergraph> graph, const FmOptions &options, FmResult &result,
+                   const vector<signed char> *fixed = NULL);
+    // parse inName, partition it with its own balance factor and write the
+    // result to outName (if not NULL); false with error set on failure
+    bool partitionFile(const char *inName, const char *outName, const FmOptions &options, FmResult &result,
+                       string &error);
+    bool writeResult(const char *outName); // result of the last job, the circuit must have names
+
+private:
+    FmEngine(const FmEngine &);
+    FmEngine &operator=(const FmEngine &);
+
+    Partitioner _partitioner; // scratch state reused by every job
+
+    bool applyFixed(const vector<signed char> &fixed); // false if its size is not the cell number
+};
+
+// one line of a batch manifest and its outcome
+struct FmJob
+{
+    string inName;  // input .dat (or cache) file
+    string outName; // result file, empty to skip writing
+    bool done;      // the job ran and its result is valid
+    string error;   // reason of a failed job
+    int cellNum;    // cells of the circuit
+    int cutSize;    // final cutsize
+    double time;    // wall time of parse, partition and output in seconds
+};
+
+// Runs many independent jobs on a thread pool. Every worker thread owns one
+// FmEngine, so the scratch arrays are reused from job to job.
+class FmBatch
+{
+public:
+    // constructor and destructor
+    FmBatch(const FmOptions &options) : _options(options), _threadNum(1) {}
+    ~FmBatch() {}
+
+    // basic access methods
+    const vector<FmJob> &getJobs() const { return _jobs; }
+
+    // set functions
+    void setThreadNum(const int threadNum) { _threadNum = threadNum; }
+
+    // modify methods
+    // one job per line, "<input file> [<output file>]", '#' starts a comment
+    bool readManifest(const char *fileName);
+    void addJob(const string &inName, const string &outName);
+    void run();
+
+private:
+    FmOptions _options;  // options of every job
+    int _threadNum;      // number of worker threads
+    vector<FmJob> _jobs; // jobs in manifest order
+};
+
+#endif // LIBFM_H
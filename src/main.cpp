@@ -1,42 +1,522 @@
+#include "eco.h"
+#include "evaluator.h"
+#include "kway.h"
+#include "libfm.h"
+#include "multilevel.h"
+#include "multistart.h"
 #include "partitioner.h"
+#include "server.h"
+#include "stats.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <sys/stat.h>
 #include <time.h>
 #include <vector>
 using namespace std;
 
+static void usage()
+{
+    cerr << "Usage: ./fm [options] <input file> <output file>" << endl
+         << "       ./fm --parse-only <input file>" << endl
+         << "       ./fm --evaluate <input file> <result file>..." << endl
+         << "       ./fm --batch=MANIFEST [options]" << endl
+         << "       ./fm --serve=SOCKET [--threads=N]" << endl
+         << "       ./fm --send=SOCKET <request>" << endl
+         << "Options:" << endl
+         << "  --parse-only   parse the input, report parse throughput and exit" << endl
+         << "  --evaluate     score 2-way result files of the input in one sweep and exit" << endl
+         << "  --batch=FILE   run the jobs of FILE (\"<input file> [<output file>]\" per line) on --threads" << endl
+         << "                 workers, each job 2-way with the other options" << endl
+         << "  --serve=SOCKET run as a daemon on a Unix socket, keeping parsed circuits resident and" << endl
+         << "                 serving --threads requests at once (see src/server.h for the protocol)" << endl
+         << "  --send=SOCKET  send one request line to a daemon and print its JSON response" << endl
+         << "  --reorder      renumber cells and nets in locality (reverse Cuthill-McKee) order first" << endl
+         << "  --multilevel   coarsen, partition the coarsest level and refine back with FM" << endl
+         << "  --starts=N     run N independent randomized FM searches and keep the best" << endl
+         << "  --threads=N    number of worker threads (default: all cores)" << endl
+         << "  --seed=N       seed of the first randomized search (default: 0)" << endl
+         << "  --kway=K       split into K blocks (a power of two) by parallel recursive bisection" << endl
+         << "  --refine=OBJ   after --kway, run direct k-way FM on cut (cut nets) or km1 (lambda - 1)" << endl
+         << "  --stop-after=K end an FM pass after K moves without a new max partial sum" << endl
+         << "  --stop-drop=D  end an FM pass once the partial sum falls D below its max" << endl
+         << "  --max-passes=N run at most N FM passes per refinement (default: 150)" << endl
+         << "  --refiner=R    refinement engine: fm (sequential FM passes, default), lp (parallel label" << endl
+         << "                 propagation on --threads) or lp+fm (label propagation, then FM passes)" << endl
+         << "  --time-limit=S stop refining S seconds after the start and keep the best partition so far" << endl
+         << "  --report=json  print only a JSON report with phase times and engine counters (2-way)" << endl
+         << "  --cache[=FILE] load the circuit from a binary cache (default: <input file>.fmb) if it is" << endl
+         << "                 up to date, otherwise parse the input and write the cache" << endl
+         << "  --compact[=FILE] keep the pins delta coded and the cell names only in FILE (default:" << endl
+         << "                 <output file>.names, removed at the end) to partition netlists near the" << endl
+         << "                 memory limit (flat 2-way)" << endl
+         << "  --eco=FILE     start from the result FILE of an earlier run and only refine around the" << endl
+         << "                 cells and nets that changed since (2-way, needs --eco-netlist)" << endl
+         << "  --eco-netlist=FILE the netlist the --eco result was computed for" << endl;
+    exit(1);
+}
+
 int main(int argc, char **argv)
 {
-    fstream input, output;
+    chrono::steady_clock::time_point programStart = chrono::steady_clock::now();
+    fstream output;
+    bool parseOnly = false;
+    bool evaluate = false;
+    bool multilevel = false;
+    bool reorder = false;
+    int startNum = 0;
+    int threadNum = ThreadPool::getDefaultThreadNum();
+    unsigned seed = 0;
+    int k = 2;
+    const char *refine = NULL;
+    int stallLimit = 0;
+    int dropLimit = 0;
+    int maxPass = -1;
+    Partitioner::Refiner refiner = Partitioner::FM_PASSES;
+    double timeLimit = 0;
+    bool jsonReport = false;
+    bool cache = false;
+    const char *cacheName = NULL;
+    const char *ecoName = NULL;
+    const char *ecoNetlistName = NULL;
+    bool compact = false;
+    const char *nameFileName = NULL;
+    const char *batchName = NULL;
+    const char *serveName = NULL;
+    const char *sendName = NULL;
+    vector<char *> files;
 
-    if (argc == 3)
+    for (int i = 1; i < argc; i++)
     {
-        input.open(argv[1], ios::in);
-        output.open(argv[2], ios::out);
-        if (!input)
+        if (strcmp(argv[i], "--parse-only") == 0)
+            parseOnly = true;
+        else if (strcmp(argv[i], "--evaluate") == 0)
+            evaluate = true;
+        else if (strcmp(argv[i], "--multilevel") == 0)
+            multilevel = true;
+        else if (strcmp(argv[i], "--reorder") == 0)
+            reorder = true;
+        else if (strncmp(argv[i], "--starts=", 9) == 0)
+            startNum = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "--threads=", 10) == 0)
+            threadNum = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--seed=", 7) == 0)
+            seed = strtoul(argv[i] + 7, NULL, 10);
+        else if (strncmp(argv[i], "--kway=", 7) == 0)
+            k = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--refine=", 9) == 0)
+            refine = argv[i] + 9;
+        else if (strncmp(argv[i], "--stop-after=", 13) == 0)
+            stallLimit = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "--stop-drop=", 12) == 0)
+            dropLimit = atoi(argv[i] + 12);
+        else if (strncmp(argv[i], "--max-passes=", 13) == 0)
+            maxPass = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "--refiner=", 10) == 0)
         {
-            cerr << "Cannot open the input file \"" << argv[1]
-                 << "\". The program will be terminated..." << endl;
+            if (!Partitioner::findRefiner(argv[i] + 10, refiner))
+            {
+                cerr << "Unknown refiner \"" << argv[i] + 10 << "\"." << endl;
+                usage();
+            }
+        }
+        else if (strncmp(argv[i], "--time-limit=", 13) == 0)
+        {
+            timeLimit = atof(argv[i] + 13);
+            if (timeLimit <= 0)
+            {
+                cerr << "The time limit must be positive." << endl;
+                usage();
+            }
+        }
+        else if (strcmp(argv[i], "--report=json") == 0)
+            jsonReport = true;
+        else if (strcmp(argv[i], "--cache") == 0)
+            cache = true;
+        else if (strncmp(argv[i], "--cache=", 8) == 0)
+        {
+            cache = true;
+            cacheName = argv[i] + 8;
+        }
+        else if (strcmp(argv[i], "--compact") == 0)
+            compact = true;
+        else if (strncmp(argv[i], "--compact=", 10) == 0)
+        {
+            compact = true;
+            nameFileName = argv[i] + 10;
+        }
+        else if (strncmp(argv[i], "--eco=", 6) == 0)
+            ecoName = argv[i] + 6;
+        else if (strncmp(argv[i], "--eco-netlist=", 14) == 0)
+            ecoNetlistName = argv[i] + 14;
+        else if (strncmp(argv[i], "--batch=", 8) == 0)
+            batchName = argv[i] + 8;
+        else if (strncmp(argv[i], "--serve=", 8) == 0)
+            serveName = argv[i] + 8;
+        else if (strncmp(argv[i], "--send=", 7) == 0)
+            sendName = argv[i] + 7;
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            cerr << "Unknown option \"" << argv[i] << "\"." << endl;
+            usage();
+        }
+        else
+            files.push_back(argv[i]);
+    }
+    if (serveName != NULL)
+    {
+        if (!files.empty() || sendName != NULL || batchName != NULL)
+            usage();
+        PartitionServer server(serveName);
+        server.setThreadNum(threadNum);
+        string error;
+        if (!server.listen(error))
+        {
+            cerr << "Cannot listen on \"" << serveName << "\": " << error << ". The program will be terminated..."
+                 << endl;
+            exit(1);
+        }
+        cout << "Serving on " << serveName << " with " << threadNum << " threads" << endl;
+        server.run();
+        return 0;
+    }
+    if (sendName != NULL)
+    {
+        if (files.empty() || batchName != NULL)
+            usage();
+        string line = files[0];
+        for (size_t i = 1; i < files.size(); i++)
+        {
+            line += string(" ") + files[i];
+        }
+        string response;
+        if (!PartitionServer::request(sendName, line, response))
+        {
+            cerr << "Cannot reach the server on \"" << sendName << "\"." << endl;
+            exit(1);
+        }
+        cout << response << endl;
+        return (response.compare(0, 11, "{\"ok\":true") == 0) ? 0 : 1;
+    }
+    if (batchName != NULL)
+    {
+        if (!files.empty() || parseOnly || evaluate || ecoName != NULL || ecoNetlistName != NULL || cache ||
+            jsonReport || k > 2 || refine != NULL)
+            usage();
+
+        FmOptions options;
+        options.seed = seed;
+        if (maxPass >= 0)
+            options.maxPass = maxPass;
+        options.refiner = refiner;
+        options.stallLimit = stallLimit;
+        options.dropLimit = dropLimit;
+        options.multilevel = multilevel;
+        options.startNum = startNum;
+        options.timeLimit = timeLimit;
+        FmBatch batch(options);
+        batch.setThreadNum(threadNum);
+        if (!batch.readManifest(batchName))
+        {
+            cerr << "Cannot open the manifest file \"" << batchName << "\". The program will be terminated..."
+                 << endl;
             exit(1);
         }
+        batch.run();
+
+        int failNum = 0;
+        for (size_t i = 0; i < batch.getJobs().size(); i++)
+        {
+            const FmJob &job = batch.getJobs()[i];
+            if (job.done)
+                cout << job.inName << ": " << job.cellNum << " cells, cutsize " << job.cutSize << ", " << job.time
+                     << "s" << endl;
+            else
+            {
+                cout << job.inName << ": " << job.error << endl;
+                ++failNum;
+            }
+        }
+        cout << "Batch: " << batch.getJobs().size() - failNum << " of " << batch.getJobs().size() << " jobs in "
+             << chrono::duration<double>(chrono::steady_clock::now() - programStart).count() << "s" << endl;
+        return (failNum > 0) ? 1 : 0;
+    }
+    if (evaluate ? (parseOnly || files.size() < 2) : files.size() != (parseOnly ? 1 : 2))
+        usage();
+    if (!KWayPartitioner::isValidK(k))
+    {
+        cerr << "The number of blocks must be a power of two." << endl;
+        usage();
+    }
+    if (refine != NULL && k <= 2)
+    {
+        cerr << "--refine only applies to --kway=K with K > 2." << endl;
+        usage();
+    }
+    if (startNum > 0 && k > 2)
+    {
+        cerr << "--starts cannot be combined with --kway, each bisection is a single search." << endl;
+        usage();
+    }
+    if (jsonReport && (k > 2 || parseOnly))
+    {
+        cerr << "--report=json is only supported for 2-way partitioning." << endl;
+        usage();
+    }
+    if (ecoName != NULL && (k > 2 || parseOnly || multilevel || startNum > 0))
+    {
+        cerr << "--eco cannot be combined with --kway, --multilevel, --starts or --parse-only." << endl;
+        usage();
+    }
+    if ((ecoName == NULL) != (ecoNetlistName == NULL))
+    {
+        cerr << "--eco and --eco-netlist must be given together." << endl;
+        usage();
+    }
+    if (ecoName != NULL && strcmp(ecoName, files[1]) == 0)
+    {
+        cerr << "The ECO result file must differ from the output file." << endl;
+        usage();
+    }
+    if (compact && (evaluate || k > 2 || multilevel || startNum > 0 || ecoName != NULL || cache || reorder))
+    {
+        cerr << "--compact only supports flat 2-way partitioning (no --evaluate, --kway, --multilevel, --starts," << endl
+             << "--eco, --cache or --reorder)." << endl;
+        usage();
+    }
+    if (refine != NULL && strcmp(refine, "cut") != 0 && strcmp(refine, "km1") != 0)
+    {
+        cerr << "Unknown refinement objective \"" << refine << "\"." << endl;
+        usage();
+    }
+
+    if (!parseOnly && !evaluate)
+    {
+        output.open(files[1], ios::out);
         if (!output)
         {
-            cerr << "Cannot open the output file \"" << argv[2]
+            cerr << "Cannot open the output file \"" << files[1]
                  << "\". The program will be terminated..." << endl;
             exit(1);
         }
     }
+
+    Partitioner *partitioner = new Partitioner();
+    chrono::steady_clock::time_point parseStart = chrono::steady_clock::now();
+    string defaultCacheName = string(files[0]) + ".fmb";
+    if (cache && cacheName == NULL)
+        cacheName = defaultCacheName.c_str();
+    // the names of a compact run are only needed for the output
+    string defaultNameFileName = (compact && !parseOnly) ? string(files[1]) + ".names" : "/dev/null";
+    if (compact && nameFileName == NULL)
+        nameFileName = defaultNameFileName.c_str();
+    bool cached = cache && partitioner->loadCache(cacheName, files[0]);
+    if (compact)
+    {
+        if (!partitioner->parseFileCoded(files[0], nameFileName))
+        {
+            cerr << "Cannot parse the input file \"" << files[0] << "\" compactly or write the name file \""
+                 << nameFileName << "\". The program will be terminated..." << endl;
+            exit(1);
+        }
+    }
+    else if (!cached)
+    {
+        if (!partitioner->parseFile(files[0]))
+        {
+            cerr << "Cannot open the input file \"" << files[0]
+                 << "\". The program will be terminated..." << endl;
+            exit(1);
+        }
+        // a cache given as the input file is already loaded from its mapping
+        if (cache && !partitioner->getGraph().isMapped() && !partitioner->saveCache(cacheName, files[0]))
+            cerr << "Warning: cannot write the cache file \"" << cacheName << "\"." << endl;
+    }
+    double parseTime = chrono::duration<double>(chrono::steady_clock::now() - parseStart).count();
+
+    if (parseOnly)
+    {
+        struct stat st;
+        double megaBytes = (stat(files[0], &st) == 0) ? st.st_size / 1e6 : 0;
+        cout << "Parsed " << partitioner->getCellNum() << " cells, " << partitioner->getNetNum() << " nets, "
+             << partitioner->getPinNum() << " pins" << endl
+             << (cached ? "Load cache: " : "Parse: ") << megaBytes << " MB in " << parseTime << "s ("
+             << (parseTime > 0 ? megaBytes / parseTime : 0) << " MB/s)" << endl;
+        partitioner->reportMemoryUsage();
+        delete partitioner;
+        return 0;
+    }
+
+    if (evaluate)
+    {
+        // pack one candidate bit per result file, then score all of them at once
+        const int candidateNum = files.size() - 1;
+        const int cellNum = partitioner->getCellNum();
+        vector<uint64_t> bits((size_t)cellNum * CutEvaluator::getWordNum(candidateNum), 0);
+        vector<char> listed;
+        for (int c = 0; c < candidateNum; c++)
+        {
+            fstream result(files[c + 1], ios::in);
+            const int unknownNum = result ? partitioner->readResult(result, listed) : -1;
+            if (unknownNum < 0)
+            {
+                cerr << "Cannot read the result file \"" << files[c + 1]
+                     << "\". The program will be terminated..." << endl;
+                exit(1);
+            }
+            const int unlistedNum = count(listed.begin(), listed.end(), 0);
+            if (unknownNum > 0 || unlistedNum > 0)
+            {
+                cerr << "The result file \"" << files[c + 1] << "\" does not match the input: " << unknownNum
+                     << " unknown cells, " << unlistedNum << " cells missing." << endl;
+                exit(1);
+            }
+            for (int i = 0; i < cellNum; i++)
+            {
+                CutEvaluator::setPart(bits, candidateNum, i, c, partitioner->getPart(i));
+            }
+        }
+
+        chrono::steady_clock::time_point evaluateStart = chrono::steady_clock::now();
+        CutEvaluator evaluator(partitioner->getGraph());
+        vector<long long> cutSize, partSizeB;
+        evaluator.countCutsize(bits, candidateNum, cutSize);
+        evaluator.countPartsize(bits, candidateNum, partSizeB);
+        double evaluateTime = chrono::duration<double>(chrono::steady_clock::now() - evaluateStart).count();
+
+        partitioner->countBalanceBound();
+        const long long totalWeight = partitioner->getGraph().getTotalWeight();
+        const int lb = partitioner->getLowerBound();
+        const int ub = partitioner->getUpperBound();
+        for (int c = 0; c < candidateNum; c++)
+        {
+            const long long partSizeA = totalWeight - partSizeB[c];
+            const bool balanced = partSizeA >= lb && partSizeA <= ub && partSizeB[c] >= lb && partSizeB[c] <= ub;
+            cout << files[c + 1] << ": cutsize " << cutSize[c] << ", part sizes " << partSizeA << " " << partSizeB[c]
+                 << (balanced ? ", balanced" : ", unbalanced") << endl;
+        }
+        cout << "Evaluated " << candidateNum << " partitions in " << evaluateTime << "s" << endl;
+        delete partitioner;
+        return 0;
+    }
+
+    // counted as parse time in the JSON report
+    if (reorder)
+    {
+        chrono::steady_clock::time_point reorderStart = chrono::steady_clock::now();
+        partitioner->reorder();
+        const double reorderTime = chrono::duration<double>(chrono::steady_clock::now() - reorderStart).count();
+        parseTime += reorderTime;
+        if (!jsonReport)
+            cout << "Reorder: " << reorderTime << "s" << endl;
+    }
+
+    partitioner->setStallLimit(stallLimit);
+    partitioner->setDropLimit(dropLimit);
+    if (maxPass >= 0)
+        partitioner->setMaxPass(maxPass);
+    partitioner->setRefiner(refiner);
+    if (timeLimit > 0)
+        partitioner->setDeadline(programStart + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                    chrono::duration<double>(timeLimit)));
+    partitioner->setVerbose(!jsonReport);
+    if (k == 2 && startNum == 0)
+        partitioner->setThreadNum(threadNum);
+    if (k > 2)
+    {
+        KWayPartitioner kway(*partitioner, k);
+        kway.setThreadNum(threadNum);
+        kway.setSeed(seed);
+        kway.setMultilevel(multilevel);
+        kway.bisect();
+        if (refine != NULL)
+        {
+            cout << "****recursive bisection: cutsize " << kway.getCutSize() << ", connectivity "
+                 << kway.getConnectivity() << "****" << endl
+                 << endl;
+            kway.refine(strcmp(refine, "cut") == 0 ? KWayRefiner::CUT_NET : KWayRefiner::CONNECTIVITY);
+        }
+        kway.printSummary();
+        kway.writeResult(output);
+        cout << "Runtime: " << chrono::duration<double>(chrono::steady_clock::now() - programStart).count() << "s"
+             << endl
+             << endl;
+        return 0;
+    }
+
+    chrono::steady_clock::time_point partitionStart = chrono::steady_clock::now();
+    if (ecoName != NULL)
+    {
+        Eco eco(*partitioner);
+        if (!eco.readNetlist(ecoNetlistName))
+        {
+            cerr << "Cannot open the netlist \"" << ecoNetlistName << "\". The program will be terminated..."
+                 << endl;
+            exit(1);
+        }
+        if (!eco.readResult(ecoName))
+        {
+            cerr << "Cannot read the result file \"" << ecoName << "\" of the netlist \"" << ecoNetlistName
+                 << "\". The program will be terminated..." << endl;
+            exit(1);
+        }
+        if (!eco.partition())
+        {
+            cerr << "The ECO partition cannot meet the balance bounds. The program will be terminated..." << endl;
+            exit(1);
+        }
+    }
+    else if (startNum > 0)
+    {
+        MultiStart ms(*partitioner);
+        ms.setStartNum(startNum);
+        ms.setThreadNum(threadNum);
+        ms.setSeed(seed);
+        ms.setMultilevel(multilevel);
+        ms.partition();
+    }
+    else if (multilevel)
+    {
+        Multilevel ml(*partitioner);
+        ml.setSeed(seed);
+        ml.partition();
+    }
     else
+        partitioner->partition();
+    double partitionTime = chrono::duration<double>(chrono::steady_clock::now() - partitionStart).count();
+
+    chrono::steady_clock::time_point outputStart = chrono::steady_clock::now();
+    const bool written = partitioner->writeResult(output);
+    output.close();
+    if (compact && nameFileName == defaultNameFileName.c_str())
+        remove(nameFileName);
+    if (!written)
     {
-        cerr << "Usage: ./fm <input file> <output file>" << endl;
+        cerr << "Cannot read the cell names back from \"" << nameFileName << "\". The program will be terminated..."
+             << endl;
         exit(1);
     }
+    double outputTime = chrono::duration<double>(chrono::steady_clock::now() - outputStart).count();
 
-    Partitioner *partitioner = new Partitioner(input);
-    partitioner->partition();
+    if (jsonReport)
+    {
+        // the initial partition is what the counting, passes and rollbacks leave
+        Stats &stats = partitioner->getStats();
+        stats.setTime(Stats::PARSE, parseTime);
+        stats.setTime(Stats::INITIAL, max(0.0, partitionTime - stats.getTime(Stats::COUNT) -
+                                                   stats.getTime(Stats::PASS) - stats.getTime(Stats::ROLLBACK)));
+        stats.setTime(Stats::OUTPUT, outputTime);
+        partitioner->writeReport(cout);
+        return 0;
+    }
     partitioner->printSummary();
-    partitioner->writeResult(output);
-    cout << "Runtime: " << (double)clock() / CLOCKS_PER_SEC << "s" << endl
+    cout << "Runtime: " << chrono::duration<double>(chrono::steady_clock::now() - programStart).count() << "s" << endl
          << endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,62 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+    // constructor and destructor
+    MappedFile() : _data(NULL), _size(0) {}
+    ~MappedFile() { close(); }
+
+    // basic access methods
+    const char *getData() const { return _data; }
+    size_t getSize() const { return _size; }
+    bool isOpen() const { return _data != NULL; }
+
+    // map the file, false if it cannot be opened or is empty
+    bool open(const char *fileName)
+    {
+        close();
+        int fd = ::open(fileName, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            return false;
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        _data = (const char *)addr;
+        _size = st.st_size;
+        return true;
+    }
+
+    void close()
+    {
+        if (_data != NULL)
+            munmap((void *)_data, _size);
+        _data = NULL;
+        _size = 0;
+    }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    const char *_data; // start of the mapping
+    size_t _size;      // length of the file in bytes
+};
+
+#endif // MAPPEDFILE_H
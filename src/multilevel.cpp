@@ -0,0 +1,160 @@
+#include "multilevel.h"
+#include "hypergraph.h"
+#include "partitioner.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+using namespace std;
+
+// nets larger than this are ignored when rating neighbours
+static const int MATCH_NET_SIZE_LIMIT = 1000;
+
+int Multilevel::match(const Hypergraph &graph, vector<int> &cellMap, const int maxWeight, const unsigned seed)
+{
+    const int cellNum = graph.getCellNum();
+    vector<int> order(cellNum);
+    for (int i = 0; i < cellNum; i++)
+        order[i] = i;
+    mt19937 rng(seed);
+    shuffle(order.begin(), order.end(), rng);
+
+    int clusterNum = 0;
+    vector<double> rating(cellNum, 0);
+    vector<int> touched;
+    cellMap.assign(cellNum, -1);
+
+    for (int k = 0; k < cellNum; k++)
+    {
+        const int u = order[k];
+        if (cellMap[u] >= 0)
+            continue;
+
+        // rate the unmatched neighbours, nets with fewer pins weigh more
+        IdSpan nl = graph.getNetList(u);
+        for (int i = 0; i < nl.size(); i++)
+        {
+            const int netSize = graph.getNetSize(nl[i]);
+            if (netSize > MATCH_NET_SIZE_LIMIT)
+                continue;
+            IdSpan cl = graph.getCellList(nl[i]);
+            for (int j = 0; j < cl.size(); j++)
+            {
+                const int v = cl[j];
+                if (v == u || cellMap[v] >= 0 || graph.getCellWeight(u) + graph.getCellWeight(v) > maxWeight)
+                    continue;
+                if (rating[v] == 0)
+                    touched.push_back(v);
+                rating[v] += (double)graph.getNetWeight(nl[i]) / (netSize - 1);
+            }
+        }
+
+        // heaviest connection per unit of cluster weight wins
+        int best = -1;
+        double bestRating = 0;
+        for (size_t i = 0; i < touched.size(); i++)
+        {
+            const int v = touched[i];
+            const double r = rating[v] / graph.getCellWeight(v);
+            if (r > bestRating)
+            {
+                bestRating = r;
+                best = v;
+            }
+            rating[v] = 0;
+        }
+        touched.clear();
+
+        cellMap[u] = clusterNum;
+        if (best >= 0)
+            cellMap[best] = clusterNum;
+        ++clusterNum;
+    }
+    return clusterNum;
+}
+
+void Multilevel::coarsen()
+{
+    const Hypergraph &finest = _partitioner.getGraph();
+    const int totalWeight = finest.getTotalWeight();
+
+    // keep clusters small against both the balance window and the coarsest size
+    int maxWeight = (int)(totalWeight * _partitioner.getBFactor() / 2);
+    maxWeight = min(maxWeight, (int)(1.5 * totalWeight / _coarsestSize));
+    maxWeight = max(maxWeight, 2);
+
+    _levels.clear();
+    _cellMap.clear();
+    const Hypergraph *fine = &finest;
+    while (fine->getCellNum() > _coarsestSize)
+    {
+        vector<int> cellMap;
+        const int clusterNum = match(*fine, cellMap, maxWeight, _seed + _levels.size());
+        if (clusterNum > 0.95 * fine->getCellNum())
+            break;
+
+        _levels.push_back(shared_ptr<Hypergraph>(new Hypergraph()));
+        fine->contract(cellMap, clusterNum, *_levels.back());
+        _cellMap.push_back(vector<int>());
+        _cellMap.back().swap(cellMap);
+        fine = _levels.back().get();
+    }
+}
+
+Partitioner *Multilevel::newLevel(const int level)
+{
+    Partitioner *partitioner = new Partitioner(_levels[level], _partitioner.getBFactor());
+    partitioner->setVerbose(false);
+    partitioner->copyOptions(_partitioner);
+    return partitioner;
+}
+
+void Multilevel::partition()
+{
+    coarsen();
+    const int levelNum = getLevelNum();
+
+    if (_verbose)
+        cout << "****multilevel: " << levelNum << " coarse levels****" << endl;
+    if (levelNum == 0)
+    {
+        _partitioner.partition();
+        return;
+    }
+
+    // initial partition of the coarsest level
+    Partitioner *coarse = newLevel(levelNum - 1);
+    coarse->partition();
+    _partitioner.getStats().merge(coarse->getStats());
+    if (_verbose)
+        cout << "level " << levelNum << ": " << coarse->getCellNum() << " cells, "
+         << coarse->getNetNum() << " nets, cutsize " << coarse->getCutSize() << endl;
+
+    // project each level onto the finer one and refine it
+    for (int level = levelNum - 1; level >= 0; level--)
+    {
+        const vector<int> &cellMap = _cellMap[level];
+        Partitioner *fine = (level > 0) ? newLevel(level - 1) : &_partitioner;
+        for (int i = 0, end = cellMap.size(); i < end; i++)
+        {
+            fine->setPart(i, coarse->getPart(cellMap[i]));
+        }
+        delete coarse;
+
+        if (level > 0)
+        {
+            fine->refine();
+            _partitioner.getStats().merge(fine->getStats());
+            if (_verbose)
+                cout << "level " << level << ": " << fine->getCellNum() << " cells, "
+                 << fine->getNetNum() << " nets, cutsize " << fine->getCutSize() << endl;
+            coarse = fine;
+        }
+        else
+        {
+            if (_verbose)
+                cout << endl;
+            _partitioner.refine();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef MULTILEVEL_H
+#define MULTILEVEL_H
+
+#include "hypergraph.h"
+#include "partitioner.h"
+#include <memory>
+#include <vector>
+using namespace std;
+
+// Multilevel V-cycle around FM: coarsen the circuit by heavy-edge
+// matching, partition the coarsest level, then project the partition back
+// level by level and refine each level with FM().
+class Multilevel
+{
+public:
+    // constructor and destructor
+    Multilevel(Partitioner &partitioner) : _partitioner(partitioner), _coarsestSize(200), _seed(0), _verbose(partitioner.getVerbose()) {}
+    ~Multilevel() {}
+
+    // basic access methods
+    int getLevelNum() const { return (int)_levels.size(); }
+
+    // set functions
+    void setCoarsestSize(const int size) { _coarsestSize = size; }
+    void setSeed(const unsigned seed) { _seed = seed; }
+    void setVerbose(const bool verbose) { _verbose = verbose; }
+
+    // modify method
+    void partition();
+
+private:
+    Partitioner &_partitioner;               // the finest level, receives the result
+    int _coarsestSize;                       // stop coarsening at this many cells
+    unsigned _seed;                          // seed of the matching visit order
+    bool _verbose;                           // print the cutsize of each level
+    vector<shared_ptr<Hypergraph> > _levels; // coarse levels, _levels[0] is the finest one
+    vector<vector<int> > _cellMap;           // _cellMap[i]: cell of the finer level -> cell of _levels[i]
+
+    void coarsen();
+    Partitioner *newLevel(const int level); // quiet partitioner of _levels[level], options of the finest level
+    int match(const Hypergraph &graph, vector<int> &cellMap, const int maxWeight, const unsigned seed);
+};
+
+#endif // MULTILEVEL_H
@@ -0,0 +1,71 @@
+#include "multistart.h"
+#include "multilevel.h"
+#include "partitioner.h"
+#include "threadpool.h"
+#include <iostream>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+void MultiStart::partition()
+{
+    Partitioner *best = NULL;
+    mutex bestMutex;
+    _cutSize.assign(_startNum, 0);
+    _bestStart = -1;
+
+    {
+        ThreadPool pool(min(_threadNum, _startNum));
+        for (int i = 0; i < _startNum; i++)
+        {
+            pool.submit([this, i, &best, &bestMutex]() {
+                Partitioner *search = new Partitioner(_partitioner.getSharedGraph(), _partitioner.getBFactor());
+                search->copyOptions(_partitioner);
+                search->setVerbose(false);
+                search->setThreadNum(1); // the starts already use every thread
+                if (_multilevel)
+                {
+                    Multilevel ml(*search);
+                    ml.setSeed(_seed + i);
+                    ml.setVerbose(false);
+                    ml.partition();
+                }
+                else
+                {
+                    search->randomPartition(_seed + i);
+                    search->refine();
+                }
+                _cutSize[i] = search->getCutSize();
+
+                // keep only the best search alive, ties go to the lower index
+                lock_guard<mutex> lock(bestMutex);
+                if (best == NULL || _cutSize[i] < _cutSize[_bestStart] ||
+                    (_cutSize[i] == _cutSize[_bestStart] && i < _bestStart))
+                {
+                    swap(best, search);
+                    _bestStart = i;
+                }
+                delete search;
+            });
+        }
+        pool.wait();
+    }
+
+    const bool verbose = _partitioner.getVerbose();
+    if (verbose)
+    {
+        for (int i = 0; i < _startNum; i++)
+        {
+            cout << "start " << i << " (seed " << _seed + i << "): cutsize " << _cutSize[i] << endl;
+        }
+        cout << "best start: " << _bestStart << endl
+             << endl;
+    }
+
+    // the best sides and counts, its passes and the counters of both
+    _partitioner.copyPartition(*best);
+    Stats stats = best->getStats();
+    stats.merge(_partitioner.getStats());
+    _partitioner.getStats() = stats;
+    delete best;
+}
@@ -0,0 +1,45 @@
+#ifndef MULTISTART_H
+#define MULTISTART_H
+
+#include "partitioner.h"
+#include <vector>
+using namespace std;
+
+// Independent FM searches run concurrently on a thread pool. Every search
+// has its own cell/net state with the options of the partitioner, shares
+// its read-only hypergraph and starts from its own seeded random partition
+// (or its own multilevel matching order). The lowest cutsize wins, ties go
+// to the lowest start index, so the result only depends on the seed and
+// the number of starts.
+class MultiStart
+{
+public:
+    // constructor and destructor
+    MultiStart(Partitioner &partitioner) : _partitioner(partitioner), _startNum(1), _threadNum(1),
+                                           _seed(0), _multilevel(false), _bestStart(-1) {}
+    ~MultiStart() {}
+
+    // basic access methods
+    int getBestStart() const { return _bestStart; }
+    int getStartCutSize(const int start) const { return _cutSize[start]; }
+
+    // set functions
+    void setStartNum(const int startNum) { _startNum = startNum; }
+    void setThreadNum(const int threadNum) { _threadNum = threadNum; }
+    void setSeed(const unsigned seed) { _seed = seed; }
+    void setMultilevel(const bool multilevel) { _multilevel = multilevel; }
+
+    // modify method
+    void partition();
+
+private:
+    Partitioner &_partitioner; // receives the best partition
+    int _startNum;             // number of independent searches
+    int _threadNum;            // number of worker threads
+    unsigned _seed;            // start i uses seed _seed + i
+    bool _multilevel;          // run a multilevel V-cycle per start
+    int _bestStart;            // index of the start with the lowest cutsize
+    vector<int> _cutSize;      // final cutsize of each start
+};
+
+#endif // MULTISTART_H
@@ -0,0 +1,181 @@
+#include "namepool.h"
+#include "binaryio.h"
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+using namespace std;
+
+unsigned NamePool::hash(const char *str, const int len)
+{
+    // FNV-1a
+    unsigned h = 2166136261u;
+    for (int i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool NamePool::equal(const int id, const char *str, const int len) const
+{
+    return (getLength(id) == len) && (memcmp(getName(id), str, len) == 0);
+}
+
+int NamePool::find(const char *str, const int len) const
+{
+    if (_slotNum == 0)
+        return -1;
+    const unsigned h = hash(str, len);
+    for (unsigned slot = h & _mask;; slot = (slot + 1) & _mask)
+    {
+        const int id = _tableData[slot];
+        if (id < 0)
+            return -1;
+        if (_hashData[id] == h && equal(id, str, len))
+            return id;
+    }
+}
+
+int NamePool::insert(const char *str, const int len, bool &isNew)
+{
+    if (_charData != _chars.data())
+        copyData();
+
+    // keep the load factor at most 1/2
+    if (2 * (size_t)(getSize() + 1) > _table.size())
+        rehash(max((size_t)16, 2 * _table.size()));
+
+    const unsigned h = hash(str, len);
+    unsigned slot = h & _mask;
+    for (; _table[slot] >= 0; slot = (slot + 1) & _mask)
+    {
+        const int id = _table[slot];
+        if (_hashes[id] == h && equal(id, str, len))
+        {
+            isNew = false;
+            return id;
+        }
+    }
+
+    const int id = getSize();
+    _table[slot] = id;
+    _hashes.push_back(h);
+    _chars.insert(_chars.end(), str, str + len);
+    _chars.push_back('\0');
+    _offset.push_back(_chars.size());
+    isNew = true;
+    bindData();
+    return id;
+}
+
+void NamePool::reserve(const int nameNum, const int charNum)
+{
+    if (_charData != _chars.data())
+        copyData();
+    _chars.reserve(charNum + nameNum);
+    _offset.reserve(nameNum + 1);
+    _hashes.reserve(nameNum);
+    size_t slotNum = 16;
+    while (slotNum < 2 * (size_t)nameNum)
+        slotNum *= 2;
+    if (slotNum > _table.size())
+        rehash(slotNum);
+    bindData();
+}
+
+void NamePool::clear()
+{
+    _chars.clear();
+    _offset.assign(1, 0);
+    _hashes.clear();
+    _table.clear();
+    _mask = 0;
+    bindData();
+}
+
+void NamePool::swap(NamePool &pool)
+{
+    _chars.swap(pool._chars);
+    _offset.swap(pool._offset);
+    _hashes.swap(pool._hashes);
+    _table.swap(pool._table);
+    std::swap(_mask, pool._mask);
+    std::swap(_charData, pool._charData);
+    std::swap(_offsetData, pool._offsetData);
+    std::swap(_hashData, pool._hashData);
+    std::swap(_tableData, pool._tableData);
+    std::swap(_nameNum, pool._nameNum);
+    std::swap(_charNum, pool._charNum);
+    std::swap(_slotNum, pool._slotNum);
+}
+
+void NamePool::rehash(const size_t slotNum)
+{
+    _table.assign(slotNum, -1);
+    _mask = slotNum - 1;
+    for (int id = 0; id < getSize(); id++)
+    {
+        unsigned slot = _hashes[id] & _mask;
+        while (_table[slot] >= 0)
+            slot = (slot + 1) & _mask;
+        _table[slot] = id;
+    }
+    _tableData = _table.data();
+    _slotNum = _table.size();
+}
+
+void NamePool::bindData()
+{
+    _charData = _chars.data();
+    _offsetData = _offset.data();
+    _hashData = _hashes.data();
+    _tableData = _table.data();
+    _nameNum = (int)_offset.size() - 1;
+    _charNum = _chars.size();
+    _slotNum = _table.size();
+}
+
+void NamePool::copyData()
+{
+    _chars.assign(_charData, _charData + _charNum);
+    _offset.assign(_offsetData, _offsetData + _nameNum + 1);
+    _hashes.assign(_hashData, _hashData + _nameNum);
+    _table.assign(_tableData, _tableData + _slotNum);
+    bindData();
+}
+
+void NamePool::save(BinaryWriter &writer) const
+{
+    const int64_t size[3] = {_nameNum, (int64_t)_slotNum, (int64_t)_charNum};
+    writer.write(size, sizeof(size));
+    writer.write(_offsetData, sizeof(int) * (_nameNum + 1));
+    writer.write(_hashData, sizeof(unsigned) * _nameNum);
+    writer.write(_tableData, sizeof(int) * _slotNum);
+    writer.write(_charData, _charNum);
+}
+
+bool NamePool::load(BinaryReader &reader)
+{
+    clear();
+    const int64_t *size = (const int64_t *)reader.read(3 * sizeof(int64_t));
+    if (size == NULL || size[0] < 0 || size[1] < 0 || size[2] < 0 || (size[1] & (size[1] - 1)) != 0)
+        return false;
+    const int *offset = (const int *)reader.read(sizeof(int) * (size[0] + 1));
+    const unsigned *hashes = (const unsigned *)reader.read(sizeof(unsigned) * size[0]);
+    const int *table = (const int *)reader.read(sizeof(int) * size[1]);
+    const char *chars = (const char *)reader.read(size[2]);
+    if (offset == NULL || hashes == NULL || table == NULL || chars == NULL)
+        return false;
+
+    _charData = chars;
+    _offsetData = offset;
+    _hashData = hashes;
+    _tableData = table;
+    _nameNum = size[0];
+    _charNum = size[2];
+    _slotNum = size[1];
+    _mask = (_slotNum > 0) ? _slotNum - 1 : 0;
+    return true;
+}
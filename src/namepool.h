@@ -0,0 +1,70 @@
+#ifndef NAMEPOOL_H
+#define NAMEPOOL_H
+
+#include "binaryio.h"
+#include <cstddef>
+#include <vector>
+using namespace std;
+
+// Interned names stored back to back in one character buffer, looked up
+// through an open-addressing (linear probing) hash table. Name i is
+// null-terminated and keeps id i for the lifetime of the pool.
+//
+// Lookups read through plain pointers, which point either at the pool's
+// own vectors or, after load(), straight into a mapped cache file.
+class NamePool
+{
+public:
+    // constructor and destructor
+    NamePool() : _mask(0) { clear(); }
+    ~NamePool() {}
+
+    // basic access methods
+    int getSize() const { return _nameNum; }
+    const char *getName(const int id) const { return _charData + _offsetData[id]; }
+    int getLength(const int id) const { return _offsetData[id + 1] - _offsetData[id] - 1; }
+    size_t getMemoryUsage() const // heap bytes owned, 0 while viewing a mapped cache
+    {
+        return _chars.capacity() + sizeof(int) * (_offset.capacity() + _table.capacity()) +
+               sizeof(unsigned) * _hashes.capacity();
+    }
+
+    // lookup and insert; insert returns the id of an existing equal name
+    int find(const char *str, const int len) const;
+    int insert(const char *str, const int len, bool &isNew);
+    void reserve(const int nameNum, const int charNum);
+    void clear();
+    void swap(NamePool &pool);
+
+    // binary cache sections; a loaded pool views the reader's memory,
+    // which must outlive it, and copies it out on the first insert
+    void save(BinaryWriter &writer) const;
+    bool load(BinaryReader &reader);
+
+private:
+    NamePool(const NamePool &);
+    NamePool &operator=(const NamePool &);
+
+    vector<char> _chars;      // all names, each followed by '\0'
+    vector<int> _offset;      // name i starts at _chars[_offset[i]]
+    vector<unsigned> _hashes; // hash value of name i
+    vector<int> _table;       // hash slots holding name ids, -1 if empty
+    unsigned _mask;           // table size - 1, size is a power of two
+
+    // the arrays above, or the same arrays in a mapped cache file
+    const char *_charData;
+    const int *_offsetData;
+    const unsigned *_hashData;
+    const int *_tableData;
+    int _nameNum;
+    size_t _charNum;
+    size_t _slotNum;
+
+    static unsigned hash(const char *str, const int len);
+    bool equal(const int id, const char *str, const int len) const;
+    void rehash(const size_t slotNum);
+    void bindData();
+    void copyData();
+};
+
+#endif // NAMEPOOL_H
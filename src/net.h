@@ -1,39 +1,48 @@
 #ifndef NET_H
 #define NET_H
 
-#include <string>
-#include <vector>
-using namespace std;
-
+// Per-side pin counts of a net. Each side also keeps the XOR of the ids of
+// its cells, which is the id of the only cell on that side whenever the
+// count is 1, so the critical cell of a net is found without a scan.
 class Net
 {
 public:
     // constructor and destructor
-    Net(string &name) : _name(name)
+    Net()
     {
         _partCount[0] = 0;
         _partCount[1] = 0;
+        _partXor[0] = 0;
+        _partXor[1] = 0;
     }
     ~Net() {}
 
     // basic access methods
-    string getName() const { return _name; }
     int getPartCount(int part) const { return _partCount[part]; }
-    vector<int> getCellList() const { return _cellList; }
+    int getLoneCell(int part) const { return _partXor[part]; } // only valid if getPartCount(part) == 1
 
     // set functions
-    void setName(const string name) { _name = name; }
-    void setPartCount(int part, const int count) { _partCount[part] = count; }
+    void clearPartCount()
+    {
+        _partCount[0] = _partCount[1] = 0;
+        _partXor[0] = _partXor[1] = 0;
+    }
 
     // modify methods
-    void incPartCount(int part) { ++_partCount[part]; }
-    void decPartCount(int part) { --_partCount[part]; }
-    void addCell(const int cellId) { _cellList.push_back(cellId); }
+    void incPartCount(int part, const int cellId)
+    {
+        ++_partCount[part];
+        _partXor[part] ^= cellId;
+    }
+    void decPartCount(int part, const int cellId)
+    {
+        --_partCount[part];
+        _partXor[part] ^= cellId;
+    }
 
 private:
-    int _partCount[2];     // Cell number in partition A(0) and B(1)
-    string _name;          // Name of the net
-    vector<int> _cellList; // List of cells the net is connected to
+    int _partCount[2]; // Cell number in partition A(0) and B(1)
+    int _partXor[2];   // XOR of the cell ids in partition A(0) and B(1)
 };
 
 #endif // NET_H
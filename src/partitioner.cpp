@@ -1,81 +1,628 @@
 #include "partitioner.h"
 #include "cell.h"
+#include "mappedfile.h"
 #include "net.h"
+#include "stats.h"
+#include "threadpool.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <climits>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <numeric>
+#include <random>
 #include <sstream>
+#include <stdint.h>
 #include <string>
-#include <unordered_set>
+#include <sys/stat.h>
 #include <vector>
 using namespace std;
 
+// smallest sweep chunk worth handing to a worker thread
+static const int PARALLEL_CHUNK_MIN = 16384;
+
+// nodes a selection looks at below an illegal head (weighted cells)
+static const int SELECT_WALK_LIMIT = 16;
+
+// a pass reads the clock once every this many moves
+static const int DEADLINE_CHECK_MOVES = 256;
+
+static inline bool isBlank(const char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// next whitespace separated token in [p, end), its length is 0 at the end
+static inline const char *nextToken(const char *&p, const char *end, int &len)
+{
+    while (p < end && isBlank(*p))
+        ++p;
+    const char *token = p;
+    while (p < end && !isBlank(*p))
+        ++p;
+    len = (int)(p - token);
+    return token;
+}
+
+// atoi() of a token that is not null-terminated, without copying it
+static inline int tokenToInt(const char *token, const int len)
+{
+    int i = 0;
+    const bool negative = (len > 0 && token[0] == '-');
+    if (len > 0 && (token[0] == '-' || token[0] == '+'))
+        ++i;
+    long long value = 0;
+    for (; i < len && token[i] >= '0' && token[i] <= '9'; i++)
+    {
+        value = min(10 * value + (token[i] - '0'), (long long)INT_MAX);
+    }
+    return negative ? -value : value;
+}
+
+// the token at p in [p, end) is the name of length len
+static inline bool isNameAt(const char *p, const char *end, const char *name, const int len)
+{
+    return p + len <= end && memcmp(p, name, len) == 0 && (p + len == end || isBlank(p[len]));
+}
+
+// 64-bit FNV-1a hash of a name with a final mix; the coded parse numbers
+// the names by it and checks each repeat against the first occurrence, two
+// of n names collide with a chance of about n^2 / 2^65
+static inline uint64_t fingerprint(const char *str, const int len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < len; i++)
+    {
+        h = (h ^ (unsigned char)str[i]) * 1099511628211ULL;
+    }
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 32);
+}
+
+// Ids by name fingerprint for the coded parse, an open-addressing (linear
+// probing) table that holds 8 bytes per name plus the slots, not the names
+class FingerprintTable
+{
+public:
+    FingerprintTable() : _mask(0) {}
+
+    int getSize() const { return _keys.size(); }
+    int find(const uint64_t key) const
+    {
+        for (size_t slot = key & _mask; !_slots.empty(); slot = (slot + 1) & _mask)
+        {
+            if (_slots[slot] < 0 || _keys[_slots[slot]] == key)
+                return _slots[slot];
+        }
+        return -1;
+    }
+    int insert(const uint64_t key, bool &isNew)
+    {
+        if (2 * (_keys.size() + 1) > _slots.size())
+            rehash(max((size_t)1024, 2 * _slots.size()));
+        size_t slot = key & _mask;
+        for (; _slots[slot] >= 0; slot = (slot + 1) & _mask)
+        {
+            if (_keys[_slots[slot]] == key)
+            {
+                isNew = false;
+                return _slots[slot];
+            }
+        }
+        isNew = true;
+        _slots[slot] = _keys.size();
+        _keys.push_back(key);
+        return _slots[slot];
+    }
+
+private:
+    vector<uint64_t> _keys; // fingerprint of each id
+    vector<int> _slots;     // ids, -1 if empty
+    size_t _mask;           // slot number - 1, a power of two
+
+    void rehash(const size_t slotNum)
+    {
+        _slots.assign(slotNum, -1);
+        _mask = slotNum - 1;
+        for (size_t i = 0; i < _keys.size(); i++)
+        {
+            size_t slot = _keys[i] & _mask;
+            while (_slots[slot] >= 0)
+                slot = (slot + 1) & _mask;
+            _slots[slot] = i;
+        }
+    }
+};
+
+// pin lists of a plain or a coded graph; the loops over them are templates
+// on these, so the plain graph does not pay for the coded one
+struct PlainLists
+{
+    typedef IdSpan Span;
+    static IdSpan getCellList(const Hypergraph &graph, const int netId) { return graph.getCellList(netId); }
+    static IdSpan getNetList(const Hypergraph &graph, const int cellId) { return graph.getNetList(cellId); }
+};
+struct CodedLists
+{
+    typedef CodedSpan Span;
+    static CodedSpan getCellList(const Hypergraph &graph, const int netId) { return graph.getCodedCellList(netId); }
+    static CodedSpan getNetList(const Hypergraph &graph, const int cellId) { return graph.getCodedNetList(cellId); }
+};
+
+// modification time of a file in nanoseconds
+static long long getModifyTime(const struct stat &st)
+{
+    return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+Partitioner::Partitioner(shared_ptr<const Hypergraph> graph, const double bFactor)
+    : _cutSize(0), _netNum(0), _cellNum(0), _maxPinNum(0), _bFactor(bFactor),
+      _maxGainCell(NULL), _accGain(0), _maxAccGain(0), _moveNum(0), _iterNum(0), _bestMoveNum(0),
+      _stallLimit(0), _dropLimit(0), _maxPass(150), _refiner(FM_PASSES), _hasDeadline(false), _timeUp(false), _lowerBound(0),
+      _upperBound(0), _verbose(true), _threadNum(1)
+{
+    _partSize[0] = 0;
+    _partSize[1] = 0;
+    setGraph(graph);
+}
+
+void Partitioner::setGraph(shared_ptr<const Hypergraph> graph)
+{
+    _graph = graph;
+    _netNum = graph->getNetNum();
+    _cellNum = graph->getCellNum();
+    _netArray.assign(_netNum, Net());
+    _cellArray.clear();
+    _cellArray.reserve(_cellNum);
+    for (int i = 0; i < _cellNum; i++)
+    {
+        _cellArray.push_back(Cell(0, i));
+    }
+}
+
+void Partitioner::reset(shared_ptr<const Hypergraph> graph, const double bFactor)
+{
+    _bFactor = bFactor;
+    setGraph(graph);
+    _cutSize = 0;
+    _partSize[0] = 0;
+    _partSize[1] = 0;
+    _moveStack.clear();
+    _moveLogStart.clear();
+    _gainLog.clear();
+    _hasDeadline = false;
+    _timeUp = false;
+    _stats.clear();
+}
+
+void Partitioner::reorder()
+{
+    vector<int> cellOrder;
+    _graph->countLocalityOrder(cellOrder);
+    shared_ptr<Hypergraph> ordered(new Hypergraph());
+    _graph->renumber(cellOrder, *ordered);
+    setGraph(ordered);
+}
+
+bool Partitioner::findRefiner(const char *name, Refiner &refiner)
+{
+    if (strcmp(name, "fm") == 0)
+        refiner = FM_PASSES;
+    else if (strcmp(name, "lp") == 0)
+        refiner = LABEL_PROPAGATION;
+    else if (strcmp(name, "lp+fm") == 0)
+        refiner = LABEL_PROPAGATION_FM;
+    else
+        return false;
+    return true;
+}
+
+void Partitioner::copyOptions(const Partitioner &partitioner)
+{
+    _stallLimit = partitioner._stallLimit;
+    _dropLimit = partitioner._dropLimit;
+    _maxPass = partitioner._maxPass;
+    _refiner = partitioner._refiner;
+    _hasDeadline = partitioner._hasDeadline;
+    _deadline = partitioner._deadline;
+    _threadNum = partitioner._threadNum;
+    _pool = partitioner._pool;
+}
+
+void Partitioner::copyPartition(const Partitioner &partitioner)
+{
+    for (int i = 0; i < _cellNum; i++)
+    {
+        _cellArray[i].setPart(partitioner._cellArray[i].getPart());
+        _cellArray[i].setGain(partitioner._cellArray[i].getGain());
+    }
+    _netArray = partitioner._netArray;
+    _partSize[0] = partitioner._partSize[0];
+    _partSize[1] = partitioner._partSize[1];
+    _cutSize = partitioner._cutSize;
+}
+
+void Partitioner::setThreadNum(const int threadNum)
+{
+    _threadNum = max(threadNum, 1);
+    if (_threadNum == 1)
+        _pool.reset();
+    else if (_pool == NULL || _pool->getThreadNum() != _threadNum)
+        _pool.reset(new ThreadPool(_threadNum));
+}
+
+int Partitioner::getChunkNum(const int n) const
+{
+    // a few chunks per thread even out uneven degrees, small sweeps stay inline
+    return max(1, min(4 * _threadNum, n / PARALLEL_CHUNK_MIN));
+}
+
+void Partitioner::parallelFor(const int n, const function<void(int, int, int)> &task)
+{
+    const int chunkNum = getChunkNum(n);
+    if (chunkNum == 1 || _pool == NULL)
+    {
+        for (int i = 0; i < chunkNum; i++)
+        {
+            task((long long)n * i / chunkNum, (long long)n * (i + 1) / chunkNum, i);
+        }
+        return;
+    }
+    for (int i = 0; i < chunkNum; i++)
+    {
+        const int begin = (long long)n * i / chunkNum;
+        const int end = (long long)n * (i + 1) / chunkNum;
+        _pool->submit([&task, begin, end, i]() { task(begin, end, i); });
+    }
+    _pool->wait();
+}
+
+bool Partitioner::parseFile(const char *fileName)
+{
+    MappedFile file;
+    if (file.open(fileName))
+    {
+        // a binary cache given in place of the .dat file
+        if (Hypergraph::isCacheFile(file.getData(), file.getSize()))
+            return loadCache(fileName, NULL);
+        parseBuffer(file.getData(), file.getData() + file.getSize());
+        return true;
+    }
+
+    // not mappable (e.g. a pipe or an empty file), read it as a stream
+    fstream inFile(fileName, ios::in);
+    if (!inFile)
+        return false;
+    parseInput(inFile);
+    return true;
+}
+
+bool Partitioner::parseFileCoded(const char *fileName, const char *nameFileName)
+{
+    MappedFile file;
+    if (!file.open(fileName) || Hypergraph::isCacheFile(file.getData(), file.getSize()))
+        return false;
+    FILE *nameFile = fopen(nameFileName, "w");
+    if (nameFile == NULL)
+        return false;
+    const char *begin = file.getData();
+    const char *end = begin + file.getSize();
+    const char *p = begin;
+    const char *token;
+    int len;
+    bool isNew;
+
+    token = nextToken(p, end, len);
+    _bFactor = (len > 0) ? stod(string(token, len)) : 0;
+    const char *body = p;
+
+    // pass 1: number the cells in order of first appearance, as
+    // parseBuffer() does, and spill each name once it is new. A repeated
+    // fingerprint is checked against the first occurrence of its name in
+    // the mapped input; two names sharing one fail the parse, since pass 2
+    // could not tell their pins apart
+    FingerprintTable cellIds;
+    vector<size_t> nameOffset;                        // input offset of the first occurrence of each cell name
+    vector<int> cellWeight;                           // CELL areas, indexed by cell id
+    vector<pair<uint64_t, int> > netWeightList;       // NETWEIGHT net fingerprints and weights
+    int netNum = 0;
+    int collision = -1; // id whose first name differs from a later one of the same fingerprint
+    while (collision < 0 && ((token = nextToken(p, end, len)), len > 0))
+    {
+        if (len == 4 && memcmp(token, "CELL", 4) == 0)
+        {
+            const char *name = nextToken(p, end, len);
+            const int nameLen = len;
+            const int cellId = cellIds.insert(fingerprint(name, nameLen), isNew);
+            if (isNew)
+            {
+                nameOffset.push_back(name - begin);
+                fprintf(nameFile, "%.*s\n", nameLen, name);
+            }
+            else if (!isNameAt(begin + nameOffset[cellId], end, name, nameLen))
+            {
+                collision = cellId;
+                token = name;
+                break;
+            }
+            token = nextToken(p, end, len);
+            if ((int)cellWeight.size() <= cellId)
+                cellWeight.resize(cellId + 1, 1);
+            cellWeight[cellId] = tokenToInt(token, len);
+            if (cellWeight[cellId] < 0)
+            {
+                cerr << "Warning: negative area of cell " << string(name, nameLen) << " set to 1" << endl;
+                cellWeight[cellId] = 1;
+            }
+            continue;
+        }
+        if (len == 9 && memcmp(token, "NETWEIGHT", 9) == 0)
+        {
+            token = nextToken(p, end, len);
+            const uint64_t key = fingerprint(token, len);
+            token = nextToken(p, end, len);
+            netWeightList.push_back(make_pair(key, tokenToInt(token, len)));
+            continue;
+        }
+        if (len != 3 || memcmp(token, "NET", 3) != 0)
+            continue;
+
+        nextToken(p, end, len);
+        while ((token = nextToken(p, end, len)), len > 0 && !(len == 1 && token[0] == ';'))
+        {
+            const int cellId = cellIds.insert(fingerprint(token, len), isNew);
+            if (isNew)
+            {
+                nameOffset.push_back(token - begin);
+                fprintf(nameFile, "%.*s\n", len, token);
+            }
+            else if (!isNameAt(begin + nameOffset[cellId], end, token, len))
+            {
+                collision = cellId;
+                break;
+            }
+        }
+        ++netNum;
+    }
+    if (collision >= 0)
+    {
+        const char *first = begin + nameOffset[collision];
+        const char *q = first;
+        int firstLen;
+        nextToken(q, end, firstLen);
+        cerr << "Error: the cell names " << string(first, firstLen) << " and " << string(token, len)
+             << " have the same fingerprint, parse without --compact" << endl;
+        fclose(nameFile);
+        return false;
+    }
+    if (fclose(nameFile) != 0)
+        return false;
+    vector<size_t>().swap(nameOffset);
+    const int cellNum = cellIds.getSize();
+
+    // pass 2: code the pins of each net
+    vector<unsigned char> netCode;
+    vector<unsigned> netCodeOffset;
+    netCodeOffset.reserve(netNum);
+    vector<int> netWeight(netWeightList.empty() ? 0 : netNum, 1);
+    vector<char> matched(netWeightList.size(), 0);
+    stable_sort(netWeightList.begin(), netWeightList.end(),
+                [](const pair<uint64_t, int> &a, const pair<uint64_t, int> &b) { return a.first < b.first; });
+    vector<int> pins;
+    p = body;
+    while ((token = nextToken(p, end, len)), len > 0)
+    {
+        if ((len == 4 && memcmp(token, "CELL", 4) == 0) || (len == 9 && memcmp(token, "NETWEIGHT", 9) == 0))
+        {
+            nextToken(p, end, len);
+            nextToken(p, end, len);
+            continue;
+        }
+        if (len != 3 || memcmp(token, "NET", 3) != 0)
+            continue;
+
+        token = nextToken(p, end, len);
+        if (!netWeightList.empty())
+        {
+            // like NamePool::find(), a weight goes to the first net of its name
+            const uint64_t key = fingerprint(token, len);
+            vector<pair<uint64_t, int> >::iterator it = lower_bound(
+                netWeightList.begin(), netWeightList.end(), make_pair(key, INT_MIN));
+            for (; it != netWeightList.end() && it->first == key; ++it)
+            {
+                const size_t i = it - netWeightList.begin();
+                if (matched[i])
+                    continue;
+                matched[i] = 1;
+                if (it->second < 1)
+                    cerr << "Warning: non-positive NETWEIGHT of net " << string(token, len) << " ignored" << endl;
+                else
+                    netWeight[netCodeOffset.size()] = it->second;
+            }
+        }
+        pins.clear();
+        int tmpCellId = -1;
+        while ((token = nextToken(p, end, len)), len > 0 && !(len == 1 && token[0] == ';'))
+        {
+            // skip a cell repeated right after itself
+            const int cellId = cellIds.find(fingerprint(token, len));
+            if (cellId != tmpCellId)
+            {
+                pins.push_back(cellId);
+                tmpCellId = cellId;
+            }
+        }
+        if (netCode.size() > UINT_MAX)
+            return false;
+        netCodeOffset.push_back(netCode.size());
+        CodedSpan::encode(pins.data(), pins.data() + pins.size(), netCode);
+    }
+    for (size_t i = 0; i < matched.size(); i++)
+    {
+        if (!matched[i])
+            cerr << "Warning: NETWEIGHT of an unknown net ignored" << endl;
+    }
+    cellIds = FingerprintTable();
+    netCode.shrink_to_fit();
+
+    shared_ptr<Hypergraph> graph(new Hypergraph());
+    if (!graph->buildCoded(cellNum, netCode, netCodeOffset))
+        return false;
+    if (!cellWeight.empty())
+    {
+        cellWeight.resize(cellNum, 1);
+        graph->setCellWeight(cellWeight);
+    }
+    if (!netWeightList.empty())
+        graph->setNetWeight(netWeight);
+    setGraph(graph);
+    _nameFileName = nameFileName;
+    return true;
+}
+
+bool Partitioner::loadCache(const char *cacheName, const char *sourceName)
+{
+    shared_ptr<Hypergraph> graph(new Hypergraph());
+    double bFactor;
+    long long sourceSize, sourceTime;
+    if (!graph->load(cacheName, bFactor, sourceSize, sourceTime))
+        return false;
+
+    // a cache made from another version of the source is stale
+    struct stat st;
+    if (sourceName != NULL &&
+        (stat(sourceName, &st) != 0 || st.st_size != sourceSize || getModifyTime(st) != sourceTime))
+        return false;
+
+    _bFactor = bFactor;
+    setGraph(graph);
+    return true;
+}
+
+bool Partitioner::saveCache(const char *cacheName, const char *sourceName) const
+{
+    struct stat st;
+    if (stat(sourceName, &st) != 0)
+        return false;
+    return _graph->save(cacheName, _bFactor, st.st_size, getModifyTime(st));
+}
+
 void Partitioner::parseInput(fstream &inFile)
 {
-    string str;
+    string buffer((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+    parseBuffer(buffer.data(), buffer.data() + buffer.size());
+}
+
+void Partitioner::parseBuffer(const char *begin, const char *end)
+{
+    const char *p = begin;
+    const char *token;
+    int len;
+    vector<int> netOffset(1, 0); // pin range of each net in netPins
+    vector<int> netPins;         // cell ids of all nets, net-major
+    vector<int> cellWeight;      // CELL areas, indexed by cell id
+    vector<pair<string, int> > netWeightList; // NETWEIGHT statements
+    NamePool netNames, cellNames;
+    netPins.reserve((end - begin) / 8);
+
     // Set balance factor
-    inFile >> str;
-    _bFactor = stod(str);
+    token = nextToken(p, end, len);
+    _bFactor = (len > 0) ? stod(string(token, len)) : 0;
 
     // Set up whole circuit
-    while (inFile >> str)
+    while ((token = nextToken(p, end, len)), len > 0)
     {
-        if (str == "NET")
+        bool isNew;
+        if (len == 4 && memcmp(token, "CELL", 4) == 0)
         {
-            string netName, cellName, tmpCellName = "";
-            inFile >> netName;
-            int netId = _netNum;
-            _netArray.push_back(new Net(netName));
-            _netName2Id[netName] = netId;
-            while (inFile >> cellName)
+            // CELL <cell name> <area>
+            token = nextToken(p, end, len);
+            int cellId = cellNames.insert(token, len, isNew);
+            token = nextToken(p, end, len);
+            if ((int)cellWeight.size() <= cellId)
+                cellWeight.resize(cellId + 1, 1);
+            cellWeight[cellId] = tokenToInt(token, len);
+            if (cellWeight[cellId] < 0)
             {
-                if (cellName == ";")
-                {
-                    tmpCellName = "";
-                    break;
-                }
-                else
-                {
-                    // a newly seen cell
-                    if (_cellName2Id.count(cellName) == 0)
-                    {
-                        int cellId = _cellNum;
-                        _cellArray.push_back(new Cell(cellName, 0, cellId));
-                        _cellName2Id[cellName] = cellId;
-                        _cellArray[cellId]->addNet(netId);
-                        _cellArray[cellId]->incPinNum();
-                        _netArray[netId]->addCell(cellId);
-                        ++_cellNum;
-                        tmpCellName = cellName;
-                    }
-                    // an existed cell
-                    else
-                    {
-                        if (cellName != tmpCellName)
-                        {
-                            assert(_cellName2Id.count(cellName) == 1);
-                            int cellId = _cellName2Id[cellName];
-                            _cellArray[cellId]->addNet(netId);
-                            _cellArray[cellId]->incPinNum();
-                            _netArray[netId]->addCell(cellId);
-                            tmpCellName = cellName;
-                        }
-                    }
-                }
+                cerr << "Warning: negative area of cell " << string(cellNames.getName(cellId)) << " set to 1" << endl;
+                cellWeight[cellId] = 1;
             }
-            ++_netNum;
+            continue;
         }
+        if (len == 9 && memcmp(token, "NETWEIGHT", 9) == 0)
+        {
+            // NETWEIGHT <net name> <weight>, the net may be defined later
+            token = nextToken(p, end, len);
+            string name(token, len);
+            token = nextToken(p, end, len);
+            netWeightList.push_back(make_pair(name, tokenToInt(token, len)));
+            continue;
+        }
+        if (len != 3 || memcmp(token, "NET", 3) != 0)
+            continue;
+
+        token = nextToken(p, end, len);
+        netNames.insert(token, len, isNew);
+        int tmpCellId = -1;
+        while ((token = nextToken(p, end, len)), len > 0)
+        {
+            if (len == 1 && token[0] == ';')
+                break;
+
+            int cellId = cellNames.insert(token, len, isNew);
+            // skip a cell repeated right after itself
+            if (cellId != tmpCellId)
+            {
+                netPins.push_back(cellId);
+                tmpCellId = cellId;
+            }
+        }
+        netOffset.push_back(netPins.size());
+    }
+
+    // Build CSR adjacency
+    const int cellNum = cellNames.getSize();
+    const int netNum = (int)netOffset.size() - 1;
+    shared_ptr<Hypergraph> graph(new Hypergraph());
+    graph->build(cellNum, netOffset, netPins);
+    if (!cellWeight.empty())
+    {
+        cellWeight.resize(cellNum, 1);
+        graph->setCellWeight(cellWeight);
+    }
+    if (!netWeightList.empty())
+    {
+        vector<int> netWeight(netNum, 1);
+        for (size_t i = 0; i < netWeightList.size(); i++)
+        {
+            const string &name = netWeightList[i].first;
+            const int netId = netNames.find(name.data(), name.size());
+            if (netId < 0)
+                cerr << "Warning: NETWEIGHT of unknown net " << name << " ignored" << endl;
+            else if (netWeightList[i].second < 1)
+                cerr << "Warning: non-positive NETWEIGHT of net " << name << " ignored" << endl;
+            else
+                netWeight[netId] = netWeightList[i].second;
+        }
+        graph->setNetWeight(netWeight);
     }
+    graph->setNames(cellNames, netNames);
+    // sized once the counts are known, a reused partitioner keeps the capacity
+    setGraph(graph);
     return;
 }
 
-void Partitioner::logicAffinity()
+template <class Lists>
+void Partitioner::logicAffinityOf()
 {
     bool allUnlock = true;
     bool partToggle = false;
@@ -83,11 +630,11 @@ void Partitioner::logicAffinity()
     // stage 1: logic affinity
     for (int i = 0; i < _netArray.size(); i++)
     {
-        vector<int> cl = _netArray[i]->getCellList();
+        typename Lists::Span cl = Lists::getCellList(*_graph, i);
         allUnlock = true;
-        for (int j = 0; j < cl.size(); j++)
+        for (const int cellId : cl)
         {
-            if (_cellArray[cl[j]]->getLock())
+            if (_cellArray[cellId].getLock())
             {
                 allUnlock = false;
                 break;
@@ -95,16 +642,17 @@ void Partitioner::logicAffinity()
         }
         if (allUnlock)
         {
-            for (int j = 0; j < cl.size(); j++)
+            for (const int cellId : cl)
             {
-                _cellArray[cl[j]]->setPart(partToggle);
-                _cellArray[cl[j]]->lock();
+                _cellArray[cellId].setPart(partToggle);
+                _cellArray[cellId].lock();
             }
             partToggle = !partToggle;
         }
     }
 
     countPartsize();
+    countBalanceBound();
 
     // stage 2: move back with not meet FM balance, and force them to be half and half
     if ((!Abalance()) && (!Bbalance()))
@@ -127,13 +675,13 @@ void Partitioner::logicAffinity()
 
         for (int i = _netArray.size() - 1; i >= 0; i--)
         {
-            vector<int> cl = _netArray[i]->getCellList();
-            for (int j = 0; j < cl.size(); j++)
+            typename Lists::Span cl = Lists::getCellList(*_graph, i);
+            for (const int cellId : cl)
             {
-                if (_cellArray[cl[j]]->getPart() == more)
+                if (_cellArray[cellId].getPart() == more)
                 {
-                    _cellArray[cl[j]]->setPart(less);
-                    gap--;
+                    _cellArray[cellId].setPart(less);
+                    gap -= _graph->getCellWeight(cellId);
                 }
                 if (gap <= 0)
                 {
@@ -147,344 +695,675 @@ void Partitioner::logicAffinity()
     }
 }
 
-void Partitioner::countNetPartCount()
+void Partitioner::logicAffinity()
 {
-    for (int i = 0; i < _netArray.size(); i++)
+    if (_graph->isCoded())
+        logicAffinityOf<CodedLists>();
+    else
+        logicAffinityOf<PlainLists>();
+}
+
+void Partitioner::randomPartition(const unsigned seed)
+{
+    vector<int> order(_cellNum);
+    for (int i = 0; i < _cellNum; i++)
+        order[i] = i;
+    mt19937 rng(seed);
+    shuffle(order.begin(), order.end(), rng);
+
+    // deal the shuffled cells to the lighter side
+    _partSize[0] = 0;
+    _partSize[1] = 0;
+    for (int i = 0; i < _cellNum; i++)
     {
-        vector<int> cl = _netArray[i]->getCellList();
-        _netArray[i]->setPartCount(0, 0);
-        _netArray[i]->setPartCount(1, 0);
-        for (int j = 0; j < cl.size(); j++)
+        const bool part = _partSize[1] < _partSize[0];
+        _cellArray[order[i]].setPart(part);
+        _partSize[part] += _graph->getCellWeight(order[i]);
+    }
+}
+
+template <class Lists>
+void Partitioner::countNetPartCountOf(const vector<int> *nets)
+{
+    const int netNum = (nets != NULL) ? nets->size() : _netNum;
+    parallelFor(netNum, [this, nets](const int begin, const int end, const int) {
+        for (int j = begin; j < end; j++)
         {
-            _netArray[i]->incPartCount(_cellArray[cl[j]]->getPart());
+            const int i = (nets != NULL) ? (*nets)[j] : j;
+            typename Lists::Span cl = Lists::getCellList(*_graph, i);
+            _netArray[i].clearPartCount();
+            for (const int cellId : cl)
+            {
+                _netArray[i].incPartCount(_cellArray[cellId].getPart(), cellId);
+            }
         }
-    }
+    });
+}
+
+void Partitioner::countNetPartCount()
+{
+    if (_graph->isCoded())
+        countNetPartCountOf<CodedLists>(NULL);
+    else
+        countNetPartCountOf<PlainLists>(NULL);
+}
+
+void Partitioner::countNetPartCount(const vector<int> &nets)
+{
+    if (_graph->isCoded())
+        countNetPartCountOf<CodedLists>(&nets);
+    else
+        countNetPartCountOf<PlainLists>(&nets);
 }
 
 void Partitioner::countCutsize()
 {
-    int counter = 0;
-    for (int i = 0; i < _netArray.size(); i++)
+    // per-chunk partial sums, added up in chunk order
+    vector<int> counter(getChunkNum(_netNum), 0);
+    parallelFor(_netNum, [this, &counter](const int begin, const int end, const int chunk) {
+        int sum = 0;
+        for (int i = begin; i < end; i++)
+        {
+            if ((_netArray[i].getPartCount(0) > 0) && (_netArray[i].getPartCount(1) > 0))
+                sum += _graph->getNetWeight(i);
+        }
+        counter[chunk] = sum;
+    });
+    _cutSize = 0;
+    for (size_t i = 0; i < counter.size(); i++)
     {
-        if ((_netArray[i]->getPartCount(0) > 0) && (_netArray[i]->getPartCount(1) > 0))
-            counter++;
+        _cutSize += counter[i];
     }
-    _cutSize = counter;
 }
 
 void Partitioner::countPartsize()
 {
-    int partSizeA = 0;
-    int partSizeB = 0;
+    vector<int> partSize(2 * getChunkNum(_cellNum), 0);
+    parallelFor(_cellNum, [this, &partSize](const int begin, const int end, const int chunk) {
+        int partSizeA = 0;
+        int partSizeB = 0;
+        for (int i = begin; i < end; i++)
+        {
+            if (!_cellArray[i].getPart())
+                partSizeA += _graph->getCellWeight(i);
+            else
+                partSizeB += _graph->getCellWeight(i);
+        }
+        partSize[2 * chunk] = partSizeA;
+        partSize[2 * chunk + 1] = partSizeB;
+    });
+    _partSize[0] = 0;
+    _partSize[1] = 0;
+    for (size_t i = 0; i < partSize.size(); i += 2)
+    {
+        _partSize[0] += partSize[i];
+        _partSize[1] += partSize[i + 1];
+    }
+}
+
+int Partitioner::countPartCellNum(const bool part) const
+{
+    int counter = 0;
     for (int i = 0; i < _cellArray.size(); i++)
     {
-        if (!_cellArray[i]->getPart())
-            partSizeA++;
-        else
-            partSizeB++;
+        if (_cellArray[i].getPart() == part)
+            counter++;
     }
-    _partSize[0] = partSizeA;
-    _partSize[1] = partSizeB;
+    return counter;
+}
+
+Partitioner::MemoryUsage Partitioner::countMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.graph = _graph->getMemoryUsage();
+    usage.cellNames = _graph->getCellNames().getMemoryUsage();
+    usage.netNames = _graph->getNetNames().getMemoryUsage();
+    usage.cells = sizeof(Cell) * _cellArray.capacity();
+    usage.nets = sizeof(Net) * _netArray.capacity();
+    usage.buckets = _bList[0].getMemoryUsage() + _bList[1].getMemoryUsage();
+    usage.moveLog = sizeof(int) * (_moveStack.capacity() + _moveLogStart.capacity()) +
+                    sizeof(pair<int, int>) * _gainLog.capacity();
+    usage.mapped = _graph->getMappedSize();
+    return usage;
 }
 
 void Partitioner::countMaxPinNum()
 {
-    int maxPinNum = 0;
+    _maxPinNum = _graph->getMaxPinNum();
+}
+
+template <class Lists>
+void Partitioner::countGainOf(const vector<int> *cells)
+{
+    // each cell sums its own net terms, so threads write disjoint gains and
+    // the result does not depend on the thread number: +w if the cell is
+    // alone on its side of the net, -w if the other side is empty
+    const int cellNum = (cells != NULL) ? cells->size() : _cellNum;
+    parallelFor(cellNum, [this, cells](const int begin, const int end, const int) {
+        for (int j = begin; j < end; j++)
+        {
+            const int i = (cells != NULL) ? (*cells)[j] : j;
+            const bool part = _cellArray[i].getPart();
+            typename Lists::Span nl = Lists::getNetList(*_graph, i);
+            int gain = 0;
+            for (const int netId : nl)
+            {
+                const Net &net = _netArray[netId];
+                if (net.getPartCount(part) == 1)
+                    gain += _graph->getNetWeight(netId);
+                if (net.getPartCount(!part) == 0)
+                    gain -= _graph->getNetWeight(netId);
+            }
+            _cellArray[i].setGain(gain);
+        }
+    });
+}
+
+void Partitioner::countGain()
+{
+    if (_graph->isCoded())
+        countGainOf<CodedLists>(NULL);
+    else
+        countGainOf<PlainLists>(NULL);
+}
+
+void Partitioner::countGain(const vector<int> &cells)
+{
+    if (_graph->isCoded())
+        countGainOf<CodedLists>(&cells);
+    else
+        countGainOf<PlainLists>(&cells);
+}
+
+void Partitioner::countBalanceBound()
+{
+    // an integer size meets x >= lb exactly when it meets x >= ceil(lb)
+    const double total = (double)_graph->getTotalWeight();
+    _lowerBound = (int)ceil((1 - getBFactor()) / 2 * total);
+    _upperBound = (int)floor((1 + getBFactor()) / 2 * total);
+}
+
+bool Partitioner::Abalance(const int weight) const
+{
+    const int sizeA = getPartSize(0) - weight;
+    const int sizeB = getPartSize(1) + weight;
+    return sizeA >= _lowerBound && sizeB >= _lowerBound && sizeA <= _upperBound && sizeB <= _upperBound;
+}
+
+bool Partitioner::Bbalance(const int weight) const
+{
+    const int sizeA = getPartSize(0) + weight;
+    const int sizeB = getPartSize(1) - weight;
+    return sizeA >= _lowerBound && sizeB >= _lowerBound && sizeA <= _upperBound && sizeB <= _upperBound;
+}
+
+bool Partitioner::isBalanced() const
+{
+    return _partSize[0] >= _lowerBound && _partSize[0] <= _upperBound && _partSize[1] >= _lowerBound &&
+           _partSize[1] <= _upperBound;
+}
+
+bool Partitioner::rebalance(const vector<int> *movable)
+{
+    countBalanceBound();
+    if (isBalanced())
+        return true;
+
+    const bool heavy = _partSize[1] > _partSize[0];
+    vector<pair<int, int> > order; // (-gain, cell) of the movable cells on the heavy side
+    const int candidateNum = (movable != NULL) ? movable->size() : _cellNum;
+    for (int i = 0; i < candidateNum; i++)
+    {
+        const int cellId = (movable != NULL) ? (*movable)[i] : i;
+        if (_cellArray[cellId].getPart() == heavy)
+            order.push_back(make_pair(-_cellArray[cellId].getGain(), cellId));
+    }
+    sort(order.begin(), order.end());
+    int partSize[2] = {_partSize[0], _partSize[1]};
+    for (size_t i = 0; i < order.size() && (partSize[heavy] > _upperBound || partSize[!heavy] < _lowerBound); i++)
+    {
+        const int weight = _graph->getCellWeight(order[i].second);
+        if (partSize[!heavy] + weight > _upperBound)
+            continue;
+        _cellArray[order[i].second].setPart(!heavy);
+        partSize[heavy] -= weight;
+        partSize[!heavy] += weight;
+    }
+    countNetPartCount();
+    countPartsize();
+    countCutsize();
+    countGain();
+    return isBalanced();
+}
+
+void Partitioner::buildBucketList(const vector<int> *region)
+{
+    _bList[0].init(_graph->getMaxGain(), _cellNum);
+    _bList[1].init(_graph->getMaxGain(), _cellNum);
+    if (region != NULL)
+    {
+        for (size_t i = 0; i < region->size(); i++)
+        {
+            Cell &cell = _cellArray[(*region)[i]];
+            cell.unlock();
+            _bList[cell.getPart()].insert(cell.getNode(), cell.getGain());
+        }
+        return;
+    }
     for (int i = 0; i < _cellArray.size(); i++)
     {
-        maxPinNum = max(maxPinNum, _cellArray[i]->getPinNum());
+        _cellArray[i].unlock(); // unlock all
+        _bList[_cellArray[i].getPart()].insert(_cellArray[i].getNode(), _cellArray[i].getGain());
     }
-    _maxPinNum = maxPinNum;
 }
 
-void Partitioner::countGain()
+void Partitioner::lockAll()
 {
-    // initial gain to zero
     for (int i = 0; i < _cellArray.size(); i++)
     {
-        _cellArray[i]->setGain(0);
+        _cellArray[i].lock();
     }
+}
 
-    // count initial gain
-    for (int i = 0; i < _netArray.size(); i++)
+void Partitioner::updateGain(Cell *cell, const int delta, const int netSize)
+{
+    const int gain = cell->getGain();
+    const int cellId = cell->getNode()->getId();
+    cell->setGain(gain + delta);
+    _gainLog.push_back(make_pair(cellId, delta));
+    STATS_GAIN_UPDATE(_stats, netSize);
+    if (!cell->getLock())
+        _bList[cell->getPart()].update(cell->getNode(), gain, gain + delta);
+    else
+        STATS_INC(_stats, LOCKED_UPDATE, 1);
+}
+
+template <class Lists>
+void Partitioner::moveCellOf(const int cellId)
+{
+    Cell &move = _cellArray[cellId];
+    const bool F = move.getPart(); // FromSet
+    const bool T = !F;             // ToSet
+    const int weight = _graph->getCellWeight(cellId);
+
+    // move the cell to opposite part, every net term of its gain flips sign
+    _cutSize -= move.getGain();
+    move.setPart(T);
+    move.setGain(-move.getGain());
+    _partSize[F] -= weight;
+    _partSize[T] += weight;
+
+    // Update Gain of the other cells, locked ones included so that the
+    // gains stay exact for rolling back and for the next pass
+    typename Lists::Span nl = Lists::getNetList(*_graph, cellId);
+    for (const int netId : nl)
     {
-        vector<int> cl = _netArray[i]->getCellList();
+        Net &net = _netArray[netId];
+        typename Lists::Span cl = Lists::getCellList(*_graph, netId);
+        const int w = _graph->getNetWeight(netId);
 
-        // all in each site
-        if (_netArray[i]->getPartCount(0) == 0 || _netArray[i]->getPartCount(1) == 0)
+        // T
+        if (net.getPartCount(T) == 0)
         {
-            for (int j = 0; j < cl.size(); j++)
+            for (const int pin : cl)
             {
-                _cellArray[cl[j]]->decGain();
+                if (pin != cellId)
+                    updateGain(&_cellArray[pin], w, cl.size());
             }
         }
+        else if (net.getPartCount(T) == 1)
+            updateGain(&_cellArray[net.getLoneCell(T)], -w, cl.size());
 
-        // alone on the part
-        if (_netArray[i]->getPartCount(0) == 1)
-        {
-            for (int j = 0; j < cl.size(); j++)
-            {
-                if (!_cellArray[cl[j]]->getPart())
-                    _cellArray[cl[j]]->incGain();
-            }
-        }
-        if (_netArray[i]->getPartCount(1) == 1)
+        // F(n) <- F(n)-1; T(n)<-T(n)+1;
+        net.decPartCount(F, cellId);
+        net.incPartCount(T, cellId);
+
+        // F
+        if (net.getPartCount(F) == 0)
         {
-            for (int j = 0; j < cl.size(); j++)
+            for (const int pin : cl)
             {
-                if (_cellArray[cl[j]]->getPart())
-                    _cellArray[cl[j]]->incGain();
+                if (pin != cellId)
+                    updateGain(&_cellArray[pin], -w, cl.size());
             }
         }
+        else if (net.getPartCount(F) == 1)
+            updateGain(&_cellArray[net.getLoneCell(F)], w, cl.size());
     }
 }
 
-bool Partitioner::Abalance()
+void Partitioner::moveCell(const int cellId)
 {
-    double lb = (1 - getBFactor()) / 2 * (double)getCellNum();
-    double ub = (1 + getBFactor()) / 2 * (double)getCellNum();
-    bool meetlb = (((getPartSize(0) - 1) >= lb) && ((getPartSize(1) + 1) >= lb));
-    bool meetub = (((getPartSize(0) - 1) <= ub) && ((getPartSize(1) + 1) <= ub));
-    return meetlb && meetub;
+    if (_graph->isCoded())
+        moveCellOf<CodedLists>(cellId);
+    else
+        moveCellOf<PlainLists>(cellId);
 }
 
-bool Partitioner::Bbalance()
+Node *Partitioner::selectNode(const bool part)
 {
-    double lb = (1 - getBFactor()) / 2 * (double)getCellNum();
-    double ub = (1 + getBFactor()) / 2 * (double)getCellNum();
-    bool meetlb = (((getPartSize(0) + 1) >= lb) && ((getPartSize(1) - 1) >= lb));
-    bool meetub = (((getPartSize(0) + 1) <= ub) && ((getPartSize(1) - 1) <= ub));
-    return meetlb && meetub;
+    // a move off part is legal exactly when the cell weighs at most the
+    // slack. With unit weights that is all cells or none, so only the head
+    // is tried; weighted cells walk down past heavy illegal heads, through
+    // the same and lower gain buckets, to the first one that fits
+    const int slack = min(_partSize[part] - _lowerBound, _upperBound - _partSize[!part]);
+    Node *node = _bList[part].getMaxGainNode();
+    for (int walk = 0; node != NULL && _graph->getCellWeight(node->getId()) > slack; walk++)
+    {
+        STATS_INC(_stats, BALANCE_REJECT, 1);
+        if (slack <= 0 || !_graph->hasCellWeight() || walk >= SELECT_WALK_LIMIT)
+            return NULL;
+        node = _bList[part].getNextNode(node, _cellArray[node->getId()].getGain());
+    }
+    return node;
 }
 
-int Partitioner::FM()
+int Partitioner::FM(const vector<int> *region)
 {
     int maxPartialSum = INT32_MIN;
     int maxPartialSumID = 0;
-    bool choose = false;
-    const int set_size = 2 * getMaxPinNum() + 1;
-    vector<int> partialSum(_cellArray.size());
-    vector<Cell *> moveCell(_cellArray.size());
-    bool F = false, T = false;           // set FromSet and ToSet
-    unordered_set<Cell *> set[set_size]; // bucket list (using unordered_set)
-    Cell *move = nullptr;                // move which cell
-    vector<int> nl;                      // netlist of the cell
-    vector<int> cl;                      // celllist of the net
-
-    // create initial bucket list
-    for (int i = 0; i < _cellArray.size(); i++)
-    {
-        _cellArray[i]->unlock(); // unlock all
-        set[getMaxPinNum() + _cellArray[i]->getGain()].insert(_cellArray[i]);
-    }
+    int partialSum = 0;
+    Cell *move = nullptr; // move which cell
 
-    // move all
-    for (int itt = 0; itt < _cellArray.size(); itt++)
     {
-        // check can move or not
-        choose = false;
+        // create initial bucket list
+        STATS_TIMER(_stats, PASS);
+        countBalanceBound();
+        buildBucketList(region);
+        _moveStack.clear();
+        _moveLogStart.clear();
+        _gainLog.clear();
+        _moveNum = 0;
 
-        //  choose which to move
-        for (int i = set_size - 1; i >= 0; i--)
+        // move all
+        const int moveLimit = (region != NULL) ? region->size() : _cellArray.size();
+        for (int itt = 0; itt < moveLimit; itt++)
         {
-            if (choose)
+            // stop mid-pass at the deadline, the rollback keeps the best prefix
+            if (itt % DEADLINE_CHECK_MOVES == 0 && isTimeUp())
                 break;
 
-            if (!set[i].empty())
+            // choose the max gain cell among the legal sides
+            Node *nodeA = selectNode(0);
+            Node *nodeB = selectNode(1);
+            STATS_INC(_stats, SELECT, 1);
+            if (nodeA != NULL && nodeB != NULL)
+                _maxGainCell = (_cellArray[nodeB->getId()].getGain() > _cellArray[nodeA->getId()].getGain()) ? nodeB : nodeA;
+            else
+                _maxGainCell = (nodeA != NULL) ? nodeA : nodeB;
+
+            if (_maxGainCell == NULL)
             {
-                for (auto iter = set[i].begin(); iter != set[i].end(); iter++)
-                {
-                    // cout << (*iter)->getName() << endl;
-                    if (!(*iter)->getPart() && Abalance() && !(*iter)->getLock()) // move from partA legal
-                    {
-                        move = (*iter);
-                        moveCell[itt] = move;
-                        choose = true;
-                        // cout << "move: " << move->getName() << endl;
-                        break;
-                    }
-                    else if ((*iter)->getPart() && Bbalance() && !(*iter)->getLock()) // move from partB legal
-                    {
-                        move = (*iter);
-                        moveCell[itt] = move;
-                        choose = true;
-                        // cout << "move: " << move->getName() << endl;
-                        break;
-                    }
-                }
+                if (_verbose && (!_bList[0].empty() || !_bList[1].empty()))
+                    cout << "Warning: not choose any thing!!!!!!!!!!!!!!!" << endl;
+                break;
             }
-        }
+            move = &_cellArray[_maxGainCell->getId()];
 
-        if (!choose)
-            cout << "Warning: not choose any thing!!!!!!!!!!!!!!!" << endl;
+            // count the maximum partial sum and id
+            partialSum += move->getGain();
+            if (partialSum > maxPartialSum)
+            {
+                maxPartialSum = partialSum;
+                maxPartialSumID = itt;
+            }
 
-        // check the move cell's FromPart and ToPart
-        F = move->getPart();
-        T = !F;
+            // lock the cell and move it to the opposite part
+            _bList[move->getPart()].remove(move->getNode(), move->getGain());
+            move->lock();
+            _moveStack.push_back(_maxGainCell->getId());
+            _moveLogStart.push_back(_gainLog.size());
+            ++_moveNum;
+            moveCell(_maxGainCell->getId());
 
-        // move the cell to opposite part
-        move->setPart(T);
-        move->lock();
-        for (int i = 0; i < set_size; i++)
-            set[i].erase(move);
-        _partSize[F]--;
-        _partSize[T]++;
+            // early stop once the partial sum curve stops improving
+            if (_stallLimit > 0 && itt - maxPartialSumID >= _stallLimit)
+                break;
+            if (_dropLimit > 0 && maxPartialSum - partialSum >= _dropLimit)
+                break;
+        }
 
-        // count the maximum partial sum and id
-        if (itt == 0)
-            partialSum[itt] = move->getGain();
-        else
-            partialSum[itt] = partialSum[itt - 1] + move->getGain();
+        STATS_INC(_stats, BUCKET_SCAN, _bList[0].getScanNum() + _bList[1].getScanNum());
+    }
+
+    // move back the moves after the best prefix
+    _bestMoveNum = (maxPartialSum > 0) ? maxPartialSumID + 1 : 0;
+    rollback();
 
-        if (partialSum[itt] > maxPartialSum)
+    return maxPartialSum;
+}
+
+int Partitioner::propagateLabels()
+{
+    // Each half round moves the positive gain cells of one side together.
+    // Moving a set of cells the same way gains at least the sum of their
+    // own gains (a net they share can only end up less cut than each gain
+    // assumed), so the moves need no conflict resolution. Candidates are
+    // admitted by gain, then id, while the balance holds, and the counts are
+    // redone by the parallel sweeps, so the result does not depend on the
+    // thread number.
+    STATS_TIMER(_stats, PASS);
+    countBalanceBound();
+    const int cutSize = _cutSize;
+    _moveNum = 0;
+    for (int side = 0; side < 2; side++)
+    {
+        const bool from = (_iterNum + side) % 2;
+        vector<vector<int> > found(getChunkNum(_cellNum));
+        parallelFor(_cellNum, [this, from, &found](const int begin, const int end, const int chunk) {
+            for (int i = begin; i < end; i++)
+            {
+                if (_cellArray[i].getPart() == from && _cellArray[i].getGain() > 0)
+                    found[chunk].push_back(i);
+            }
+        });
+        _moveStack.clear();
+        for (size_t i = 0; i < found.size(); i++)
         {
-            maxPartialSum = partialSum[itt];
-            maxPartialSumID = itt;
+            _moveStack.insert(_moveStack.end(), found[i].begin(), found[i].end());
         }
+        stable_sort(_moveStack.begin(), _moveStack.end(),
+                    [this](const int a, const int b) { return _cellArray[a].getGain() > _cellArray[b].getGain(); });
 
-        // Update Gain
-        nl = move->getNetList();
-        for (int i = 0; i < nl.size(); i++)
+        size_t moveNum = 0;
+        for (size_t i = 0; i < _moveStack.size(); i++)
         {
-            // T
-            cl = _netArray[nl[i]]->getCellList();
-            if (_netArray[nl[i]]->getPartCount(T) == 0)
+            const int weight = _graph->getCellWeight(_moveStack[i]);
+            if (_partSize[from] - weight >= _lowerBound && _partSize[!from] + weight <= _upperBound)
             {
-                for (int j = 0; j < cl.size(); j++)
-                {
-                    if (!_cellArray[cl[j]]->getLock())
-                    {
-                        set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].erase(_cellArray[cl[j]]);
-                        _cellArray[cl[j]]->incGain();
-                        set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].insert(_cellArray[cl[j]]);
-                    }
-                }
+                _partSize[from] -= weight;
+                _partSize[!from] += weight;
+                _moveStack[moveNum++] = _moveStack[i];
             }
-            else if (_netArray[nl[i]]->getPartCount(T) == 1)
+        }
+        if (moveNum == 0)
+            continue;
+        parallelFor(moveNum, [this](const int begin, const int end, const int) {
+            for (int i = begin; i < end; i++)
             {
-                for (int j = 0; j < cl.size(); j++)
-                {
-                    if (_cellArray[cl[j]]->getPart() == T)
-                    {
-                        if (!_cellArray[cl[j]]->getLock())
-                        {
-                            set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].erase(_cellArray[cl[j]]);
-                            _cellArray[cl[j]]->decGain();
-                            set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].insert(_cellArray[cl[j]]);
-                        }
-                    }
-                }
+                _cellArray[_moveStack[i]].move();
             }
+        });
+        _moveNum += moveNum;
+        countNetPartCount();
+        countCutsize();
+        countGain();
+    }
+    _moveStack.clear();
+    ++_iterNum;
+    return cutSize - _cutSize;
+}
 
-            // F(n) <- F(n)-1; T(n)<-T(n)+1;
-            _netArray[nl[i]]->decPartCount(F);
-            _netArray[nl[i]]->incPartCount(T);
+bool Partitioner::isTimeUp()
+{
+    if (!_timeUp && _hasDeadline && chrono::steady_clock::now() >= _deadline)
+    {
+        _timeUp = true;
+        if (_verbose)
+            cout << "Time limit reached, keeping the best partition so far" << endl;
+    }
+    return _timeUp;
+}
 
-            // F
-            if (_netArray[nl[i]]->getPartCount(F) == 0)
-            {
-                for (int j = 0; j < cl.size(); j++)
-                {
-                    if (!_cellArray[cl[j]]->getLock())
-                    {
-                        set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].erase(_cellArray[cl[j]]);
-                        _cellArray[cl[j]]->decGain();
-                        set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].insert(_cellArray[cl[j]]);
-                    }
-                }
-            }
-            else if (_netArray[nl[i]]->getPartCount(F) == 1)
-            {
-                for (int j = 0; j < cl.size(); j++)
-                {
-                    if (_cellArray[cl[j]]->getPart() == F)
-                    {
-                        if (!_cellArray[cl[j]]->getLock())
-                        {
-                            set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].erase(_cellArray[cl[j]]);
-                            _cellArray[cl[j]]->incGain();
-                            set[getMaxPinNum() + _cellArray[cl[j]]->getGain()].insert(_cellArray[cl[j]]);
-                        }
-                    }
-                }
-            }
-        }
+void Partitioner::rollback()
+{
+    if (_bestMoveNum >= (int)_moveStack.size())
+        return;
+    STATS_TIMER(_stats, ROLLBACK);
 
-        // show the set
-        // for (int i = 0; i < set_size; i++)
-        // {
-        //     cout << "gain =" << i - getMaxPinNum() << " : ";
-        //     for (const auto &s : set[i])
-        //     {
-        //         cout << s->getName() << " ";
-        //     }
-        //     cout << endl;
-        // }
-        // reportCellGain();
-        // reportCellPart();
-        // cout << "-----------------------------move a cell end-----------------------------" << endl;
+    // undoing touches the logged gain changes and the pins of the undone
+    // cells; a full recount sweeps all pins a few times
+    long long undoCost = (long long)_gainLog.size() - _moveLogStart[_bestMoveNum];
+    for (int i = _bestMoveNum; i < _moveStack.size(); i++)
+    {
+        undoCost += _graph->isCoded() ? _graph->getCodedNetList(_moveStack[i]).size()
+                                      : _graph->getCellDegree(_moveStack[i]);
     }
 
-    // move back
-    if (maxPartialSum > 0)
+    if (undoCost < 2LL * getPinNum())
+    {
+        for (int i = _moveStack.size() - 1; i >= _bestMoveNum; i--)
+        {
+            undoMove(i);
+        }
+    }
+    else
     {
-        for (int i = maxPartialSumID + 1; i < moveCell.size(); i++)
+        STATS_INC(_stats, RECOUNT, 1);
+        for (int i = _bestMoveNum; i < _moveStack.size(); i++)
         {
-            moveCell[i]->setPart(!moveCell[i]->getPart());
+            _cellArray[_moveStack[i]].move();
         }
+        _gainLog.resize(_moveLogStart[_bestMoveNum]);
+        _moveLogStart.resize(_bestMoveNum);
+        countNetPartCount();
+        countPartsize();
+        countCutsize();
+        countGain();
     }
+    _moveStack.resize(_bestMoveNum);
+}
 
-    countNetPartCount();
-    countPartsize();
-    countCutsize();
-    countGain();
+template <class Lists>
+void Partitioner::undoMoveOf(const int moveId)
+{
+    const int cellId = _moveStack[moveId];
+    Cell &move = _cellArray[cellId];
+    const bool T = move.getPart(); // ToSet of the move being undone
+    const bool F = !T;             // FromSet of the move being undone
+    const int weight = _graph->getCellWeight(cellId);
+    STATS_INC(_stats, UNDO_MOVE, 1);
 
-    // show
-    // for (int i = 0; i < _cellArray.size(); i++)
-    // {
-    //     cout << "partialSum: " << partialSum[i] << " move: " << moveCell[i]->getName() << endl;
-    // }
-    // cout << "maxPartialSum: " << maxPartialSum << endl;
-    // cout << "-----------------------------one iteration end-----------------------------" << endl;
+    // revert the gain changes the move caused, newest first
+    for (int i = _gainLog.size() - 1; i >= _moveLogStart[moveId]; i--)
+    {
+        _cellArray[_gainLog[i].first].addGain(-_gainLog[i].second);
+    }
+    _gainLog.resize(_moveLogStart[moveId]);
+    _moveLogStart.resize(moveId);
 
-    return maxPartialSum;
+    // put the cell and its net counts back
+    typename Lists::Span nl = Lists::getNetList(*_graph, cellId);
+    for (const int netId : nl)
+    {
+        _netArray[netId].decPartCount(T, cellId);
+        _netArray[netId].incPartCount(F, cellId);
+    }
+    move.setPart(F);
+    move.setGain(-move.getGain());
+    _partSize[T] -= weight;
+    _partSize[F] += weight;
+    _cutSize += move.getGain();
 }
 
-void Partitioner::partition()
+void Partitioner::undoMove(const int moveId)
 {
-    // set the initial partition
-    logicAffinity();
-    countNetPartCount();
-    countPartsize();
-    countCutsize();
-    countGain();
-    countMaxPinNum();
+    if (_graph->isCoded())
+        undoMoveOf<CodedLists>(moveId);
+    else
+        undoMoveOf<PlainLists>(moveId);
+}
+
+void Partitioner::refine()
+{
+    {
+        STATS_TIMER(_stats, COUNT);
+        countNetPartCount();
+        countPartsize();
+        countCutsize();
+        countGain();
+        countMaxPinNum();
+    }
+    if (_passCallback)
+        _passCallback(0);
 
     // report initial partition
-    cout << "****initial partition****" << endl;
-    reportMaxPinNum();
-    reportCutsize();
-    cout << endl;
+    if (_verbose)
+    {
+        cout << "****initial partition****\n";
+        reportMaxPinNum();
+        reportCutsize();
+        cout << '\n';
+    }
     // reportNetPartCount();
     // reportCellPart();
     // reportCellGain();
 
+    // parallel label propagation, alone or ahead of the FM passes
+    int pass = 0;
+    if (_refiner != FM_PASSES)
+    {
+        int gain = 1;
+        _iterNum = 0; // the first round starts from side A
+        for (int i = 1; (i <= _maxPass) && (gain > 0) && !isTimeUp(); i++)
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            gain = propagateLabels();
+            Stats::Pass record = {gain, _moveNum, _moveNum, _cutSize,
+                                  chrono::duration<double>(chrono::steady_clock::now() - start).count()};
+            _stats.addPass(record);
+            if (_passCallback)
+                _passCallback(++pass);
+            if (_verbose)
+            {
+                cout << "****label propagation round: " << i << "****\n";
+                cout << "gain: " << gain << '\n';
+                cout << "moves: " << _moveNum << " / " << _cellNum << '\n';
+                reportCutsize();
+                cout << '\n';
+            }
+        }
+        if (_refiner == LABEL_PROPAGATION)
+            return;
+    }
+
     // do the FM
     int MPS = 777; // maximum partial sum in each itheration
     const int earlyBreakTime = 100;
     vector<int> count5(5);
-    for (int i = 1; (i <= 150) && (MPS > 0); i++)
+    for (int i = 1; (i <= _maxPass) && (MPS > 0) && !isTimeUp(); i++)
     {
-        cout << "****iteration: " << i << "****" << endl;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
         MPS = FM();
-        cout << "maxPartialSum: " << MPS << endl;
-        reportCutsize();
-        cout << endl;
+        Stats::Pass record = {MPS, _moveNum, _bestMoveNum, _cutSize,
+                              chrono::duration<double>(chrono::steady_clock::now() - start).count()};
+        _stats.addPass(record);
+        if (_passCallback)
+            _passCallback(pass + i);
+        if (_verbose)
+        {
+            cout << "****iteration: " << i << "****\n";
+            cout << "maxPartialSum: " << MPS << '\n';
+            cout << "moves: " << _moveNum << " / " << _cellNum << '\n';
+            reportCutsize();
+            cout << '\n';
+        }
 
         count5[i % 5] = MPS;
         if ((i > earlyBreakTime) && (accumulate(count5.begin(), count5.end(), 0) < 20))
         {
-            cout << "Early Break" << endl;
+            if (_verbose)
+                cout << "Early Break" << endl;
             break;
         }
     }
@@ -495,6 +1374,44 @@ void Partitioner::partition()
     // reportCellGain();
 }
 
+int Partitioner::refineRegion(const vector<int> &region)
+{
+    int totalGain = 0;
+    int MPS = 777;
+    for (int i = 1; (i <= _maxPass) && (MPS > 0) && !isTimeUp(); i++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        MPS = FM(&region);
+        Stats::Pass pass = {MPS, _moveNum, _bestMoveNum, _cutSize,
+                            chrono::duration<double>(chrono::steady_clock::now() - start).count()};
+        _stats.addPass(pass);
+        if (MPS > 0)
+            totalGain += MPS;
+        if (_verbose)
+        {
+            cout << "****region pass: " << i << "****\n";
+            cout << "maxPartialSum: " << MPS << '\n';
+            cout << "moves: " << _moveNum << " / " << region.size() << '\n';
+            reportCutsize();
+            cout << '\n';
+        }
+    }
+
+    // the cells of the region that did not move are still unlocked
+    for (size_t i = 0; i < region.size(); i++)
+    {
+        _cellArray[region[i]].lock();
+    }
+    return totalGain;
+}
+
+void Partitioner::partition()
+{
+    // set the initial partition
+    logicAffinity();
+    refine();
+}
+
 void Partitioner::printSummary() const
 {
     cout << endl;
@@ -502,8 +1419,14 @@ void Partitioner::printSummary() const
     cout << " Cutsize: " << _cutSize << endl;
     cout << " Total cell number: " << _cellNum << endl;
     cout << " Total net number:  " << _netNum << endl;
-    cout << " Cell Number of partition A: " << _partSize[0] << endl;
-    cout << " Cell Number of partition B: " << _partSize[1] << endl;
+    cout << " Cell Number of partition A: " << countPartCellNum(0) << endl;
+    cout << " Cell Number of partition B: " << countPartCellNum(1) << endl;
+    if (_graph->hasCellWeight())
+    {
+        cout << " Area of partition A: " << _partSize[0] << endl;
+        cout << " Area of partition B: " << _partSize[1] << endl;
+    }
+    reportMemoryUsage();
     cout << "=================================================" << endl;
     cout << endl;
     return;
@@ -514,11 +1437,11 @@ void Partitioner::reportNet() const
     cout << "Number of nets: " << _netNum << endl;
     for (size_t i = 0, end_i = _netArray.size(); i < end_i; ++i)
     {
-        cout << setw(8) << _netArray[i]->getName() << ": ";
-        vector<int> cellList = _netArray[i]->getCellList();
+        cout << setw(8) << getNetName(i) << ": ";
+        IdSpan cellList = _graph->getCellList(i);
         for (size_t j = 0, end_j = cellList.size(); j < end_j; ++j)
         {
-            cout << setw(8) << _cellArray[cellList[j]]->getName() << " ";
+            cout << setw(8) << getCellName(cellList[j]) << " ";
         }
         cout << endl;
     }
@@ -530,11 +1453,11 @@ void Partitioner::reportCell() const
     cout << "Number of cells: " << _cellNum << endl;
     for (size_t i = 0, end_i = _cellArray.size(); i < end_i; ++i)
     {
-        cout << setw(8) << _cellArray[i]->getName() << ": ";
-        vector<int> netList = _cellArray[i]->getNetList();
+        cout << setw(8) << getCellName(i) << ": ";
+        IdSpan netList = _graph->getNetList(i);
         for (size_t j = 0, end_j = netList.size(); j < end_j; ++j)
         {
-            cout << setw(8) << _netArray[netList[j]]->getName() << " ";
+            cout << setw(8) << getNetName(netList[j]) << " ";
         }
         cout << endl;
     }
@@ -546,7 +1469,7 @@ void Partitioner::reportCellGain() const
     cout << "==================== Cell Gain ====================" << endl;
     for (int i = 0, end_i = _cellArray.size(); i < end_i; ++i)
     {
-        cout << setw(8) << _cellArray[i]->getName() << " gain: " << _cellArray[i]->getGain() << endl;
+        cout << setw(8) << getCellName(i) << " gain: " << _cellArray[i].getGain() << endl;
     }
 }
 
@@ -555,7 +1478,7 @@ void Partitioner::reportCellPart() const
     cout << "==================== Cell Part ====================" << endl;
     for (int i = 0, end_i = _cellArray.size(); i < end_i; ++i)
     {
-        cout << setw(8) << _cellArray[i]->getName() << " part: " << _cellArray[i]->getPart() << endl;
+        cout << setw(8) << getCellName(i) << " part: " << _cellArray[i].getPart() << endl;
     }
 }
 
@@ -564,59 +1487,135 @@ void Partitioner::reportNetPartCount() const
     cout << "==================== Net PartCount ====================" << endl;
     for (int i = 0; i < _netArray.size(); i++)
     {
-        cout << _netArray[i]->getName() << ": " << _netArray[i]->getPartCount(0) << " " << _netArray[i]->getPartCount(1) << endl;
+        cout << getNetName(i) << ": " << _netArray[i].getPartCount(0) << " " << _netArray[i].getPartCount(1) << endl;
     }
 }
 
 void Partitioner::reportCutsize() const
 {
-    cout << "CutSize is: " << getCutSize() << endl;
+    cout << "CutSize is: " << getCutSize() << '\n';
 }
 
 void Partitioner::reportMaxPinNum() const
 {
-    cout << "maxPinNum is: " << getMaxPinNum() << endl;
+    cout << "maxPinNum is: " << getMaxPinNum() << '\n';
 }
 
-void Partitioner::writeResult(fstream &outFile)
+bool Partitioner::writeResult(fstream &outFile)
 {
+    // a coded graph reads its names back from the name file, once per side
+    const bool named = _graph->hasNames() || _nameFileName.empty();
     stringstream buff;
     buff << _cutSize;
     outFile << "Cutsize = " << buff.str() << '\n';
-    buff.str("");
-    buff << _partSize[0];
-    outFile << "G1 " << buff.str() << '\n';
-    for (size_t i = 0, end = _cellArray.size(); i < end; ++i)
+    for (int part = 0; part < 2; part++)
     {
-        if (_cellArray[i]->getPart() == 0)
+        buff.str("");
+        buff << countPartCellNum(part);
+        outFile << "G" << part + 1 << " " << buff.str() << '\n';
+        ifstream nameFile;
+        string name;
+        if (!named)
         {
-            outFile << _cellArray[i]->getName() << " ";
+            nameFile.open(_nameFileName.c_str());
+            if (!nameFile.is_open())
+                return false;
         }
+        for (size_t i = 0, end = _cellArray.size(); i < end; ++i)
+        {
+            if (!named && !getline(nameFile, name))
+                return false;
+            if (_cellArray[i].getPart() == part)
+            {
+                if (named)
+                    outFile << getCellName(i) << " ";
+                else
+                    outFile << name << " ";
+            }
+        }
+        outFile << ";\n";
     }
-    outFile << ";\n";
-    buff.str("");
-    buff << _partSize[1];
-    outFile << "G2 " << buff.str() << '\n';
-    for (size_t i = 0, end = _cellArray.size(); i < end; ++i)
+    return true;
+}
+
+int Partitioner::readResult(fstream &inFile, vector<char> &listed, int *cutSize)
+{
+    // Cutsize = N, then G1 and G2 each with a count and names up to ';'
+    listed.assign(_cellNum, 0);
+    if (cutSize != NULL)
+        *cutSize = -1;
+    int unknownNum = 0;
+    string token;
+    while (inFile >> token)
     {
-        if (_cellArray[i]->getPart() == 1)
+        if (token == "Cutsize")
+        {
+            int value;
+            if (!(inFile >> token >> value) || token != "=")
+                return -1;
+            if (cutSize != NULL)
+                *cutSize = value;
+            continue;
+        }
+        if (token != "G1" && token != "G2")
+            return -1;
+        const bool part = (token == "G2");
+        int count;
+        if (!(inFile >> count))
+            return -1;
+        int nameNum = 0;
+        while (inFile >> token && token != ";")
         {
-            outFile << _cellArray[i]->getName() << " ";
+            ++nameNum;
+            const int cellId = _graph->getCellNames().find(token.data(), token.size());
+            if (cellId < 0)
+                ++unknownNum;
+            else
+            {
+                _cellArray[cellId].setPart(part);
+                listed[cellId] = 1;
+            }
         }
+        // a group shorter or longer than its count is a truncated or edited file
+        if (token != ";" || nameNum != count)
+            return -1;
     }
-    outFile << ";\n";
-    return;
+    return unknownNum;
+}
+
+void Partitioner::reportMemoryUsage() const
+{
+    const MemoryUsage usage = countMemoryUsage();
+    const double mb = 1e6;
+    cout << fixed << setprecision(1);
+    cout << " Memory (MB): graph " << usage.graph / mb << ", names " << (usage.cellNames + usage.netNames) / mb
+         << ", cells " << usage.cells / mb << ", nets " << usage.nets / mb << ", buckets " << usage.buckets / mb
+         << ", move log " << usage.moveLog / mb << ", total " << usage.getTotal() / mb;
+    if (usage.mapped > 0)
+        cout << " (+" << usage.mapped / mb << " mapped)";
+    cout << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+void Partitioner::writeReport(ostream &out) const
+{
+    out << "{\"cells\":" << _cellNum << ",\"nets\":" << _netNum << ",\"pins\":" << getPinNum()
+        << ",\"cutsize\":" << _cutSize << ",\"part_cells\":[" << countPartCellNum(0) << ","
+        << countPartCellNum(1) << "],\"part_size\":[" << _partSize[0] << "," << _partSize[1]
+        << "],\"memory\":";
+    const MemoryUsage usage = countMemoryUsage();
+    out << "{\"graph\":" << usage.graph << ",\"cell_names\":" << usage.cellNames << ",\"net_names\":"
+        << usage.netNames << ",\"cells\":" << usage.cells << ",\"nets\":" << usage.nets << ",\"buckets\":"
+        << usage.buckets << ",\"move_log\":" << usage.moveLog << ",\"mapped\":" << usage.mapped
+        << ",\"total\":" << usage.getTotal() << "},\"stats\":";
+    _stats.writeJson(out);
+    out << "}\n";
 }
 
 void Partitioner::clear()
 {
-    for (size_t i = 0, end = _cellArray.size(); i < end; ++i)
-    {
-        delete _cellArray[i];
-    }
-    for (size_t i = 0, end = _netArray.size(); i < end; ++i)
-    {
-        delete _netArray[i];
-    }
+    _cellArray.clear();
+    _netArray.clear();
     return;
-}
\ No newline at end of file
+}
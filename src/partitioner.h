@@ -1,24 +1,67 @@
 #ifndef PARTITIONER_H
 #define PARTITIONER_H
 
+#include "bucket.h"
 #include "cell.h"
+#include "hypergraph.h"
 #include "net.h"
+#include "stats.h"
+#include "threadpool.h"
+#include <chrono>
 #include <fstream>
-#include <map>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 using namespace std;
 
 class Partitioner
 {
 public:
+    // heap bytes held per structure
+    struct MemoryUsage
+    {
+        size_t graph;     // CSR arrays and weights
+        size_t cellNames; // cell name pool
+        size_t netNames;  // net name pool
+        size_t cells;     // cell array, bucket nodes included
+        size_t nets;      // per-net part counts
+        size_t buckets;   // gain buckets of both sides
+        size_t moveLog;   // move stack and gain log of the last pass
+        size_t mapped;    // binary cache mapping, page cache rather than heap, not in the total
+
+        size_t getTotal() const { return graph + cellNames + netNames + cells + nets + buckets + moveLog; }
+    };
+
+    // engine of refine()
+    enum Refiner
+    {
+        FM_PASSES,            // sequential FM passes
+        LABEL_PROPAGATION,    // parallel label propagation rounds
+        LABEL_PROPAGATION_FM, // label propagation rounds, then FM passes as a polish
+    };
+
     // constructor and destructor
+    Partitioner() : _cutSize(0), _netNum(0), _cellNum(0), _maxPinNum(0), _bFactor(0),
+                    _maxGainCell(NULL), _accGain(0), _maxAccGain(0), _moveNum(0), _iterNum(0),
+                    _bestMoveNum(0), _stallLimit(0), _dropLimit(0), _maxPass(150), _refiner(FM_PASSES), _hasDeadline(false), _timeUp(false),
+                    _lowerBound(0), _upperBound(0),
+                    _verbose(true), _threadNum(1), _graph(new Hypergraph())
+    {
+        _partSize[0] = 0;
+        _partSize[1] = 0;
+    }
     Partitioner(fstream &inFile) : _cutSize(0), _netNum(0), _cellNum(0), _maxPinNum(0), _bFactor(0),
-                                   _accGain(0), _maxAccGain(0), _iterNum(0)
+                                   _maxGainCell(NULL), _accGain(0), _maxAccGain(0), _moveNum(0), _iterNum(0),
+                                   _bestMoveNum(0), _stallLimit(0), _dropLimit(0), _maxPass(150), _refiner(FM_PASSES), _hasDeadline(false), _timeUp(false),
+                                   _lowerBound(0), _upperBound(0),
+                                   _verbose(true), _threadNum(1), _graph(new Hypergraph())
     {
         parseInput(inFile);
         _partSize[0] = 0;
         _partSize[1] = 0;
     }
+    Partitioner(shared_ptr<const Hypergraph> graph, const double bFactor);
     ~Partitioner()
     {
         clear();
@@ -29,20 +72,97 @@ public:
     int getMaxPinNum() const { return _maxPinNum; }
     int getNetNum() const { return _netNum; }
     int getCellNum() const { return _cellNum; }
+    int getPinNum() const { return _graph->getPinNum(); }
     double getBFactor() const { return _bFactor; }
     int getPartSize(int part) const { return _partSize[part]; }
+    int getLowerBound() const { return _lowerBound; }
+    int getUpperBound() const { return _upperBound; }
+    const char *getNetName(int netId) const { return _graph->getNetName(netId); }
+    const char *getCellName(int cellId) const { return _graph->getCellName(cellId); }
+    const Hypergraph &getGraph() const { return *_graph; }
+    shared_ptr<const Hypergraph> getSharedGraph() const { return _graph; }
+    bool getPart(int cellId) const { return _cellArray[cellId].getPart(); }
+    int getGain(int cellId) const { return _cellArray[cellId].getGain(); }
+    bool getVerbose() const { return _verbose; }
+    int getMoveNum() const { return _moveNum; }
+    int getStallLimit() const { return _stallLimit; }
+    int getDropLimit() const { return _dropLimit; }
+    int getMaxPass() const { return _maxPass; }
+    bool hasDeadline() const { return _hasDeadline; }
+    const chrono::steady_clock::time_point &getDeadline() const { return _deadline; }
+    Refiner getRefiner() const { return _refiner; }
+    static bool findRefiner(const char *name, Refiner &refiner); // "fm", "lp" or "lp+fm"
+    int getThreadNum() const { return _threadNum; }
+    Stats &getStats() { return _stats; }
+    const Stats &getStats() const { return _stats; }
+
+    // set functions
+    void setPart(int cellId, const bool part) { _cellArray[cellId].setPart(part); }
+    void setCutSize(const int cutSize) { _cutSize = cutSize; } // a cutsize known without countCutsize()
+    void setVerbose(const bool verbose) { _verbose = verbose; }
+    void setStallLimit(const int stallLimit) { _stallLimit = stallLimit; }
+    void setDropLimit(const int dropLimit) { _dropLimit = dropLimit; }
+    void setMaxPass(const int maxPass) { _maxPass = maxPass; }
+    void setRefiner(const Refiner refiner) { _refiner = refiner; }
+    void setDeadline(const chrono::steady_clock::time_point &deadline)
+    {
+        _deadline = deadline;
+        _hasDeadline = true;
+    }
+    void setThreadNum(const int threadNum); // threads of the count functions
+    // called by refine() with 0 once the initial gains are counted, then with
+    // the number of each finished FM pass
+    void setPassCallback(const function<void(int)> &passCallback) { _passCallback = passCallback; }
+    void copyOptions(const Partitioner &partitioner);
+    // take the sides, part counts, sizes, cutsize and gains of a partitioner
+    // of the same circuit; the bucket lists are not copied, every pass
+    // rebuilds them from the cell array
+    void copyPartition(const Partitioner &partitioner);
 
     // modify method
+    bool parseFile(const char *fileName);
+    // parse in two streaming passes into a coded graph: the first numbers
+    // the cells by name fingerprint and writes their names to nameFileName,
+    // one per line by id, the second codes the pins; writeResult() reads the
+    // names back from that file, which must be kept until then
+    bool parseFileCoded(const char *fileName, const char *nameFileName);
+    // take another circuit, keeping the options and the capacity of the arrays
+    void reset(shared_ptr<const Hypergraph> graph, const double bFactor);
+    // renumber the cells and nets in locality order (before partitioning)
+    void reorder();
+    bool loadCache(const char *cacheName, const char *sourceName);
+    bool saveCache(const char *cacheName, const char *sourceName) const;
     void parseInput(fstream &inFile);
     void logicAffinity();
+    void randomPartition(const unsigned seed);
     void countNetPartCount();
+    void countNetPartCount(const vector<int> &nets); // only these nets, the others keep their counts
     void countCutsize();
     void countPartsize();
     void countMaxPinNum();
+    int countPartCellNum(const bool part) const;
+    MemoryUsage countMemoryUsage() const;
     void countGain();
-    bool Abalance();
-    bool Bbalance();
-    int FM();
+    void countGain(const vector<int> &cells); // only these cells, their nets must be counted
+    void countBalanceBound();
+    bool Abalance(const int weight = 1) const; // moving weight from A to B keeps both sizes in bounds
+    bool Bbalance(const int weight = 1) const; // moving weight from B to A keeps both sizes in bounds
+    bool isBalanced() const; // both sizes are in bounds
+    // move cells of movable (all if NULL) off the heavy side, best gain
+    // first, until both sizes are in bounds; FM cannot do it since every
+    // move it makes must keep both sides in bounds. Expects counted part
+    // counts, sizes and gains, recounts them and returns isBalanced()
+    bool rebalance(const vector<int> *movable = NULL);
+    int FM(const vector<int> *region = NULL); // one pass, moving only the cells of region if given
+    // one round of parallel label propagation, returns the gain; expects
+    // counted part counts, sizes, cutsize and gains and leaves them counted
+    int propagateLabels();
+    bool isTimeUp(); // the deadline has passed, passes then stop at the best prefix
+    void refine();
+    void lockAll();
+    // passes moving only the cells of region, all others must be locked;
+    // expects counted part counts, sizes, cutsize and gains, returns the gain
+    int refineRegion(const vector<int> &region);
     void partition();
 
     // member functions about reporting
@@ -54,29 +174,81 @@ public:
     void reportNetPartCount() const;
     void reportCutsize() const;
     void reportMaxPinNum() const;
-    void writeResult(fstream &outFile);
+    void reportMemoryUsage() const;
+    bool writeResult(fstream &outFile); // false if a coded graph's name file is missing or short
+    // set the sides of the cells named in a 2-way result; returns the number
+    // of names not in the circuit, -1 if it is not a 2-way result or a
+    // group does not hold as many names as its count. cutSize receives the
+    // cutsize the file reports, -1 if it has no Cutsize line
+    int readResult(fstream &inFile, vector<char> &listed, int *cutSize = NULL);
+    void writeReport(ostream &out) const; // JSON run report with the statistics
 
 private:
-    int _cutSize;                  // cut size
-    int _partSize[2];              // size (cell number) of partition A(0) and B(1)
+    // the bucket lists link nodes inside the cell array, a copy would point into the original
+    Partitioner(const Partitioner &);
+    Partitioner &operator=(const Partitioner &);
+
+    int _cutSize;                  // cut size, the summed weight of the cut nets
+    int _partSize[2];              // size (cell weight) of partition A(0) and B(1)
     int _netNum;                   // number of nets
     int _cellNum;                  // number of cells
     int _maxPinNum;                // Pmax for building bucket list
     double _bFactor;               // the balance factor to be met
     Node *_maxGainCell;            // pointer to max gain cell
-    vector<Net *> _netArray;       // net array of the circuit
-    vector<Cell *> _cellArray;     // cell array of the circuit
-    map<int, Node *> _bList[2];    // bucket list of partition A(0) and B(1)
-    map<string, int> _netName2Id;  // mapping from net name to id
-    map<string, int> _cellName2Id; // mapping from cell name to id
-
-    int _accGain;           // accumulative gain
-    int _maxAccGain;        // maximum accumulative gain
-    int _moveNum;           // number of cell movements
-    int _iterNum;           // number of iterations
-    int _bestMoveNum;       // store best number of movements
-    int _unlockNum[2];      // number of unlocked cells
-    vector<int> _moveStack; // history of cell movement
+    vector<Net> _netArray;         // net array of the circuit
+    vector<Cell> _cellArray;       // cell array of the circuit
+    BucketList _bList[2];          // bucket list of partition A(0) and B(1)
+
+    int _accGain;              // accumulative gain
+    int _maxAccGain;           // maximum accumulative gain
+    int _moveNum;              // number of cell movements
+    int _iterNum;              // number of iterations
+    int _bestMoveNum;          // store best number of movements
+    int _unlockNum[2];         // number of unlocked cells
+    int _stallLimit;           // end a pass after this many moves without a new max partial sum (0: off)
+    int _dropLimit;            // end a pass once the partial sum is this far below the max (0: off)
+    int _maxPass;              // pass limit of refine() and refineRegion(), and round limit of label propagation
+    Refiner _refiner;          // engine of refine()
+    bool _hasDeadline;         // _deadline is set
+    bool _timeUp;              // _deadline has passed
+    chrono::steady_clock::time_point _deadline; // no pass moves a cell after this
+    int _lowerBound;           // min part size, ceil((1 - b) / 2 * total weight)
+    int _upperBound;           // max part size, floor((1 + b) / 2 * total weight)
+    vector<int> _moveStack;    // history of cell movement
+    vector<int> _moveLogStart; // first _gainLog entry of each move
+    vector<pair<int, int> > _gainLog; // (cell, gain change) of each gain update of a move
+    bool _verbose;             // print the progress of each pass
+    function<void(int)> _passCallback; // observer of the FM passes, may be empty
+    Stats _stats;              // counters and timers of the runs
+    int _threadNum;            // threads of the count functions
+    shared_ptr<ThreadPool> _pool; // workers of the count functions, NULL with one thread
+
+    shared_ptr<const Hypergraph> _graph; // adjacency and names, shared read-only
+    string _nameFileName;      // cell names of a coded graph, which keeps none
+
+    // Tokenize and build the circuit from an in-memory .dat file
+    void parseBuffer(const char *begin, const char *end);
+    void setGraph(shared_ptr<const Hypergraph> graph);
+
+    // run task(begin, end, chunk) over the chunks of [0, n), on the pool if
+    // n is large enough; chunks depend only on n and the thread number
+    int getChunkNum(const int n) const;
+    void parallelFor(const int n, const function<void(int, int, int)> &task);
+
+    // the loops over pin lists, for PlainLists or CodedLists (partitioner.cpp)
+    template <class Lists> void logicAffinityOf();
+    template <class Lists> void countNetPartCountOf(const vector<int> *nets); // all if NULL
+    template <class Lists> void countGainOf(const vector<int> *cells);        // all if NULL
+    template <class Lists> void moveCellOf(const int cellId);
+    template <class Lists> void undoMoveOf(const int moveId);
+
+    // Bucket list maintenance
+    void buildBucketList(const vector<int> *region = NULL);
+    Node *selectNode(const bool part); // max gain node of part whose move keeps the balance, NULL if none
+    void updateGain(Cell *cell, const int delta, const int netSize);
+    void moveCell(const int cellId);
+    void undoMove(const int moveId);
+    void rollback();
 
     // Clean up partitioner
     void clear();
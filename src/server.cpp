@@ -0,0 +1,535 @@
+#include "server.h"
+#include "binaryio.h"
+#include "hypergraph.h"
+#include "libfm.h"
+#include "mappedfile.h"
+#include "partitioner.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+static double secondsSince(const chrono::steady_clock::time_point &start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// JSON string literal of str, file names are the only free text
+static string quote(const string &str)
+{
+    string out = "\"";
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        if (str[i] == '"' || str[i] == '\\')
+            out += '\\';
+        if ((unsigned char)str[i] >= 0x20)
+            out += str[i];
+    }
+    return out + "\"";
+}
+
+static string errorResponse(const string &error)
+{
+    return "{\"ok\":false,\"error\":" + quote(error);
+}
+
+// value as a whole number in [low, high], false if it is not one
+static bool parseInteger(const char *value, const long long low, const long long high, long long &number)
+{
+    char *end;
+    errno = 0;
+    number = strtoll(value, &end, 10);
+    return end != value && *end == '\0' && errno == 0 && number >= low && number <= high;
+}
+
+// value as a number in [low, high], false if it is not one
+static bool parseReal(const char *value, const double low, const double high, double &number)
+{
+    char *end;
+    errno = 0;
+    number = strtod(value, &end);
+    return end != value && *end == '\0' && errno == 0 && number >= low && number <= high;
+}
+
+static bool sendAll(const int fd, const string &data)
+{
+    for (size_t sent = 0; sent < data.size();)
+    {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+static bool setAddress(const char *socketName, sockaddr_un &address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketName) >= sizeof(address.sun_path))
+        return false;
+    strcpy(address.sun_path, socketName);
+    return true;
+}
+
+PartitionServer::~PartitionServer()
+{
+    if (_listenFd >= 0)
+    {
+        close(_listenFd);
+        unlink(_socketName.c_str());
+    }
+}
+
+bool PartitionServer::listen(string &error)
+{
+    sockaddr_un address;
+    if (!setAddress(_socketName.c_str(), address))
+    {
+        error = "socket path too long";
+        return false;
+    }
+    _listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listenFd < 0)
+    {
+        error = strerror(errno);
+        return false;
+    }
+    // a socket file left by a server that did not shut down cleanly
+    unlink(_socketName.c_str());
+    if (bind(_listenFd, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(_listenFd, 64) != 0)
+    {
+        error = strerror(errno);
+        close(_listenFd);
+        _listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void PartitionServer::run()
+{
+    const int threadNum = max(_threadNum, 1);
+    for (int i = 0; i < threadNum; i++)
+    {
+        _engines.push_back(unique_ptr<FmEngine>(new FmEngine()));
+        _idle.push_back(_engines.back().get());
+    }
+
+    ThreadPool pool(threadNum);
+    while (!_stop)
+    {
+        const int fd = accept(_listenFd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break; // SHUTDOWN shuts the listening socket down
+        }
+        timeval timeout;
+        timeout.tv_sec = IDLE_TIMEOUT;
+        timeout.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        {
+            lock_guard<mutex> lock(_clientMutex);
+            _clients.insert(fd);
+            if (_stop)
+                ::shutdown(fd, SHUT_RD);
+        }
+        pool.submit([this, fd]() { serve(fd); });
+    }
+    pool.wait();
+    close(_listenFd);
+    _listenFd = -1;
+    unlink(_socketName.c_str());
+}
+
+void PartitionServer::serve(const int fd)
+{
+    // one response line per request line, the last line may lack its '\n';
+    // recv fails once the idle timeout passes and returns 0 after SHUTDOWN
+    string buffer;
+    char chunk[4096];
+    bool open = true;
+    while (open && !_stop)
+    {
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            // idle timeout or read error, a partial line is not a request
+            open = false;
+            buffer.clear();
+        }
+        else if (n == 0)
+        {
+            open = false;
+            buffer += '\n';
+        }
+        else
+            buffer.append(chunk, n);
+
+        size_t end;
+        while ((end = buffer.find('\n')) != string::npos)
+        {
+            string line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line[line.size() - 1] == '\r')
+                line.erase(line.size() - 1);
+            if (line.find_first_not_of(" \t") == string::npos)
+                continue;
+            if (!sendAll(fd, handle(line) + "\n"))
+                open = false;
+            if (_stop)
+                break;
+        }
+        if (buffer.size() > MAX_LINE_LENGTH)
+        {
+            // answer, then discard the rest so the client reads the error
+            sendAll(fd, errorResponse("request line too long") + "}\n");
+            ::shutdown(fd, SHUT_WR);
+            while (recv(fd, chunk, sizeof(chunk), 0) > 0)
+                ;
+            open = false;
+        }
+    }
+    {
+        lock_guard<mutex> lock(_clientMutex);
+        _clients.erase(fd);
+    }
+    close(fd);
+}
+
+string PartitionServer::handle(const string &line)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    istringstream tokens(line);
+    string command;
+    vector<string> args;
+    tokens >> command;
+    for (string arg; tokens >> arg;)
+    {
+        args.push_back(arg);
+    }
+
+    string response;
+    double loadTime = 0;
+    if (command == "LOAD" && args.size() == 1)
+    {
+        string hash, error;
+        Circuit circuit;
+        bool hit;
+        if (loadCircuit(args[0], hash, circuit, hit, error))
+        {
+            loadTime = secondsSince(start);
+            ostringstream json;
+            json << "{\"ok\":true,\"graph\":\"" << hash << "\",\"cache\":\"" << (hit ? "hit" : "miss")
+                 << "\",\"cells\":" << circuit.graph->getCellNum() << ",\"nets\":" << circuit.graph->getNetNum()
+                 << ",\"pins\":" << circuit.graph->getPinNum();
+            response = json.str();
+        }
+        else
+            response = errorResponse(error);
+    }
+    else if (command == "PARTITION" && !args.empty())
+        response = partition(args[0], vector<string>(args.begin() + 1, args.end()), loadTime);
+    else if (command == "STATS" && args.empty())
+        response = writeStats();
+    else if (command == "SHUTDOWN" && args.empty())
+    {
+        _stop = true;
+        ::shutdown(_listenFd, SHUT_RDWR);
+        // pending responses still go out, idle connections stop waiting
+        lock_guard<mutex> lock(_clientMutex);
+        for (set<int>::const_iterator it = _clients.begin(); it != _clients.end(); ++it)
+        {
+            ::shutdown(*it, SHUT_RD);
+        }
+        response = "{\"ok\":true";
+    }
+    else
+        response = errorResponse("unknown request \"" + command + "\"");
+
+    const double time = secondsSince(start);
+    {
+        lock_guard<mutex> lock(_metricMutex);
+        ++_requestNum;
+        if (response.compare(0, 11, "{\"ok\":false") == 0)
+            ++_errorNum;
+        _latencySum += time;
+        _latencyMax = max(_latencyMax, time);
+        if (_latency.size() < LATENCY_WINDOW)
+            _latency.push_back(time);
+        else
+            _latency[_latencyNext] = time;
+        _latencyNext = (_latencyNext + 1) % LATENCY_WINDOW;
+    }
+    ostringstream json;
+    json << response << ",\"time_ms\":{\"load\":" << loadTime * 1e3 << ",\"total\":" << time * 1e3 << "}}";
+    return json.str();
+}
+
+string PartitionServer::partition(const string &fileName, const vector<string> &args, double &loadTime)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string hash, error;
+    Circuit circuit;
+    bool hit;
+    if (!loadCircuit(fileName, hash, circuit, hit, error))
+        return errorResponse(error);
+    loadTime = secondsSince(start);
+
+    // key=value parameters, one job never spreads over more than one thread
+    FmOptions options;
+    options.bFactor = circuit.bFactor;
+    string fixedName, outName;
+    bool sides = false;
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        const size_t eq = args[i].find('=');
+        const string key = args[i].substr(0, eq);
+        const char *value = (eq == string::npos) ? "" : args[i].c_str() + eq + 1;
+        bool valid = true;
+        long long number = 0;
+        if (key == "b")
+            valid = parseReal(value, 0, 1, options.bFactor) && options.bFactor < 1;
+        else if (key == "seed")
+        {
+            valid = parseInteger(value, 0, UINT_MAX, number);
+            options.seed = number;
+        }
+        else if (key == "multilevel")
+        {
+            valid = parseInteger(value, 0, 1, number);
+            options.multilevel = number != 0;
+        }
+        else if (key == "starts")
+        {
+            valid = parseInteger(value, 0, INT_MAX, number);
+            options.startNum = number;
+        }
+        else if (key == "max-passes")
+        {
+            valid = parseInteger(value, 1, INT_MAX, number);
+            options.maxPass = number;
+        }
+        else if (key == "refiner")
+        {
+            if (!Partitioner::findRefiner(value, options.refiner))
+                return errorResponse("unknown refiner \"" + string(value) + "\"");
+        }
+        else if (key == "time-limit")
+            valid = parseReal(value, 0, HUGE_VAL, options.timeLimit);
+        else if (key == "fixed")
+            fixedName = value;
+        else if (key == "output")
+            outName = value;
+        else if (key == "sides")
+        {
+            valid = parseInteger(value, 0, 1, number);
+            sides = number != 0;
+        }
+        else
+            return errorResponse("unknown parameter \"" + key + "\"");
+        if (!valid)
+            return errorResponse("invalid value of \"" + key + "\"");
+    }
+
+    // pinned cells come as a G1/G2 result file listing only those cells
+    vector<signed char> fixed;
+    if (!fixedName.empty())
+    {
+        Partitioner reader(circuit.graph, options.bFactor);
+        vector<char> listed;
+        fstream fixedFile(fixedName.c_str(), ios::in);
+        // a full result ("Cutsize = N" first) must cover the circuit, a
+        // pin list may name any subset of its cells
+        string first;
+        const bool full = fixedFile >> first && first == "Cutsize";
+        fixedFile.clear();
+        fixedFile.seekg(0);
+        const int unknownNum = fixedFile ? reader.readResult(fixedFile, listed) : -1;
+        if (unknownNum < 0)
+            return errorResponse("cannot read the fixed cells");
+        if (unknownNum > 0)
+            return errorResponse("the fixed cells name cells that are not in the circuit");
+        if (full && count(listed.begin(), listed.end(), 1) != (int)listed.size())
+            return errorResponse("the fixed result misses cells of the circuit");
+        fixed.assign(listed.size(), -1);
+        for (size_t i = 0; i < listed.size(); i++)
+        {
+            if (listed[i])
+                fixed[i] = reader.getPart(i);
+        }
+    }
+
+    FmEngine *engine;
+    {
+        lock_guard<mutex> lock(_engineMutex);
+        engine = _idle.back();
+        _idle.pop_back();
+    }
+    FmResult result;
+    const bool done = engine->partition(circuit.graph, options, result, fixed.empty() ? NULL : &fixed);
+    const bool written = !done || outName.empty() || engine->writeResult(outName.c_str());
+    {
+        lock_guard<mutex> lock(_engineMutex);
+        _idle.push_back(engine);
+    }
+    if (!done)
+        return errorResponse("the fixed sides do not match the circuit");
+    if (!written)
+        return errorResponse("cannot write the output file");
+
+    ostringstream json;
+    json << "{\"ok\":true,\"graph\":\"" << hash << "\",\"cache\":\"" << (hit ? "hit" : "miss")
+         << "\",\"cells\":" << circuit.graph->getCellNum() << ",\"cutsize\":" << result.cutSize
+         << ",\"part_size\":[" << result.partSize[0] << "," << result.partSize[1]
+         << "],\"balanced\":" << (result.balanced ? "true" : "false")
+         << ",\"passes\":" << result.stats.getPasses().size() << ",\"partition_ms\":" << result.time * 1e3;
+    if (sides)
+    {
+        json << ",\"sides\":\"";
+        for (size_t i = 0; i < result.part.size(); i++)
+        {
+            json << (result.part[i] ? '1' : '0');
+        }
+        json << "\"";
+    }
+    return json.str();
+}
+
+bool PartitionServer::loadCircuit(const string &fileName, string &hash, Circuit &circuit, bool &hit,
+                                  string &error)
+{
+    struct stat st;
+    if (stat(fileName.c_str(), &st) != 0)
+    {
+        error = "cannot open the input file";
+        return false;
+    }
+    const long long time = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+    // hash the content only if the file changed since it was last hashed
+    hash.clear();
+    {
+        lock_guard<mutex> lock(_cacheMutex);
+        map<string, FileKey>::const_iterator key = _fileKeys.find(fileName);
+        if (key != _fileKeys.end() && key->second.size == st.st_size && key->second.time == time)
+            hash = key->second.hash;
+    }
+    if (hash.empty())
+    {
+        MappedFile file;
+        if (!file.open(fileName.c_str()))
+        {
+            error = "cannot open the input file";
+            return false;
+        }
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx",
+                 (unsigned long long)checksumWords(CHECKSUM_SEED, file.getData(), file.getSize()));
+        hash = text;
+        FileKey key = {(long long)st.st_size, time, hash};
+        lock_guard<mutex> lock(_cacheMutex);
+        _fileKeys[fileName] = key;
+    }
+
+    {
+        lock_guard<mutex> lock(_cacheMutex);
+        map<string, Circuit>::const_iterator found = _circuits.find(hash);
+        if (found != _circuits.end())
+        {
+            circuit = found->second;
+            hit = true;
+            lock_guard<mutex> metricLock(_metricMutex);
+            ++_hitNum;
+            return true;
+        }
+    }
+
+    // parse outside the lock; a concurrent parse of the same content keeps
+    // the first circuit inserted
+    Partitioner parser;
+    if (!parser.parseFile(fileName.c_str()))
+    {
+        error = "cannot open the input file";
+        return false;
+    }
+    circuit.graph = parser.getSharedGraph();
+    circuit.bFactor = parser.getBFactor();
+    hit = false;
+    lock_guard<mutex> lock(_cacheMutex);
+    circuit = _circuits.insert(make_pair(hash, circuit)).first->second;
+    lock_guard<mutex> metricLock(_metricMutex);
+    ++_missNum;
+    return true;
+}
+
+string PartitionServer::writeStats()
+{
+    size_t circuitNum;
+    {
+        lock_guard<mutex> lock(_cacheMutex);
+        circuitNum = _circuits.size();
+    }
+    lock_guard<mutex> lock(_metricMutex);
+    vector<double> latency(_latency);
+    sort(latency.begin(), latency.end());
+    const size_t n = latency.size();
+    ostringstream json;
+    json << "{\"ok\":true,\"requests\":" << _requestNum << ",\"errors\":" << _errorNum << ",\"graphs\":" << circuitNum
+         << ",\"cache_hits\":" << _hitNum << ",\"cache_misses\":" << _missNum << ",\"latency_ms\":{\"mean\":"
+         << (_requestNum > 0 ? _latencySum / _requestNum * 1e3 : 0) << ",\"p50\":" << (n > 0 ? latency[n / 2] * 1e3 : 0)
+         << ",\"p95\":" << (n > 0 ? latency[min(n - 1, n * 95 / 100)] * 1e3 : 0)
+         << ",\"max\":" << _latencyMax * 1e3 << "}";
+    return json.str();
+}
+
+bool PartitionServer::request(const char *socketName, const string &line, string &response)
+{
+    sockaddr_un address;
+    if (!setAddress(socketName, address))
+        return false;
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0 || !sendAll(fd, line + "\n"))
+    {
+        close(fd);
+        return false;
+    }
+    ::shutdown(fd, SHUT_WR);
+
+    response.clear();
+    char chunk[4096];
+    ssize_t n;
+    while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0 || (n < 0 && errno == EINTR))
+    {
+        if (n > 0)
+            response.append(chunk, n);
+    }
+    close(fd);
+    if (!response.empty() && response[response.size() - 1] == '\n')
+        response.erase(response.size() - 1);
+    return !response.empty();
+}
@@ -0,0 +1,105 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "hypergraph.h"
+#include "libfm.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Partitioning daemon on a Unix domain socket. Parsed circuits stay
+// resident, keyed by a hash of the file content, so repeated requests on
+// the same netlist skip parsing. Connections are served concurrently on a
+// thread pool. Each request is one line and gets one JSON line back:
+//
+//   LOAD <file>                  parse (or find) the circuit, report its hash
+//   PARTITION <file> [key=value] partition it; keys: b, seed, multilevel,
+//                                starts, max-passes, refiner, time-limit, fixed (a
+//                                result file of pinned cells), output (a
+//                                result file to write), sides (1: inline)
+//   STATS                        cache and latency metrics, the percentiles
+//                                over the last LATENCY_WINDOW requests
+//   SHUTDOWN                     stop accepting, close the connections and exit
+//
+// A connection idle for IDLE_TIMEOUT seconds is closed, so idle clients
+// cannot hold the workers; a partial line left by the timeout is dropped.
+// A line longer than MAX_LINE_LENGTH gets an error and closes the
+// connection. Values must parse whole and be in range. A fixed file may
+// not name cells outside the circuit, and if it is a full result (with
+// its Cutsize line) it must list every cell.
+class PartitionServer
+{
+public:
+    // constructor and destructor
+    PartitionServer(const char *socketName)
+        : _socketName(socketName), _threadNum(1), _listenFd(-1), _stop(false), _requestNum(0), _errorNum(0),
+          _hitNum(0), _missNum(0), _latencySum(0), _latencyMax(0), _latencyNext(0) {}
+    ~PartitionServer();
+
+    // set functions
+    void setThreadNum(const int threadNum) { _threadNum = threadNum; }
+
+    // modify methods
+    bool listen(string &error); // bind the socket, replacing a stale one
+    void run();                 // serve until a SHUTDOWN request
+
+    // connect, send one request line and read the response line
+    static bool request(const char *socketName, const string &line, string &response);
+
+private:
+    static const size_t LATENCY_WINDOW = 4096; // latencies kept for the percentiles
+    static const int IDLE_TIMEOUT = 60;        // seconds a connection may wait between requests
+    static const size_t MAX_LINE_LENGTH = 1 << 16; // longer request lines close the connection
+
+    PartitionServer(const PartitionServer &);
+    PartitionServer &operator=(const PartitionServer &);
+
+    // a parsed circuit and the balance factor of its file
+    struct Circuit
+    {
+        shared_ptr<const Hypergraph> graph;
+        double bFactor;
+    };
+    // content hash of a file as of the size and modification time it had
+    struct FileKey
+    {
+        long long size;
+        long long time;
+        string hash;
+    };
+
+    string _socketName;                // path of the socket file
+    int _threadNum;                    // connections served at once
+    int _listenFd;                     // listening socket, -1 if closed
+    atomic<bool> _stop;                // SHUTDOWN was received
+    mutex _clientMutex;                // guards _clients
+    set<int> _clients;                 // open connections, read side shut down on SHUTDOWN
+    mutex _cacheMutex;                 // guards _circuits and _fileKeys
+    map<string, Circuit> _circuits;    // resident circuits by content hash
+    map<string, FileKey> _fileKeys;    // file name -> hash, skips rehashing unchanged files
+    mutex _engineMutex;                // guards _idle
+    vector<unique_ptr<FmEngine> > _engines; // one per worker thread
+    vector<FmEngine *> _idle;          // engines not serving a request
+    mutex _metricMutex;                // guards the metrics below
+    long long _requestNum;             // requests answered
+    long long _errorNum;               // requests answered with an error
+    long long _hitNum;                 // circuits found resident
+    long long _missNum;                // circuits parsed
+    double _latencySum;                // wall time of all requests in seconds
+    double _latencyMax;                // slowest request in seconds
+    vector<double> _latency;           // ring of the last LATENCY_WINDOW request times
+    size_t _latencyNext;               // slot of _latency the next request takes
+
+    void serve(const int fd);
+    string handle(const string &line);
+    string partition(const string &fileName, const vector<string> &args, double &loadTime);
+    bool loadCircuit(const string &fileName, string &hash, Circuit &circuit, bool &hit, string &error);
+    string writeStats();
+};
+
+#endif // SERVER_H
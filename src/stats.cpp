@@ -0,0 +1,83 @@
+#include "stats.h"
+#include <ostream>
+#include <vector>
+using namespace std;
+
+static const char *const counterName[Stats::COUNTER_NUM] = {
+    "selections", "bucket_scans", "balance_rejects", "gain_updates", "locked_gain_updates", "undo_moves", "recounts"};
+static const char *const phaseName[Stats::PHASE_NUM] = {
+    "parse", "initial", "count", "passes", "rollback", "output"};
+
+bool Stats::isEnabled()
+{
+#ifdef FM_NO_STATS
+    return false;
+#else
+    return true;
+#endif
+}
+
+void Stats::merge(const Stats &stats)
+{
+    for (int i = 0; i < COUNTER_NUM; i++)
+        _counter[i] += stats._counter[i];
+    for (int i = 0; i < SIZE_CLASS_NUM; i++)
+        _gainUpdate[i] += stats._gainUpdate[i];
+    for (int i = 0; i < PHASE_NUM; i++)
+        _time[i] += stats._time[i];
+}
+
+void Stats::clear()
+{
+    for (int i = 0; i < COUNTER_NUM; i++)
+        _counter[i] = 0;
+    for (int i = 0; i < SIZE_CLASS_NUM; i++)
+        _gainUpdate[i] = 0;
+    for (int i = 0; i < PHASE_NUM; i++)
+        _time[i] = 0;
+    _passes.clear();
+}
+
+void Stats::writeJson(ostream &out) const
+{
+    out << "{\"enabled\":" << (isEnabled() ? "true" : "false");
+
+    out << ",\"time\":{";
+    double total = 0;
+    for (int i = 0; i < PHASE_NUM; i++)
+    {
+        out << (i > 0 ? "," : "") << "\"" << phaseName[i] << "\":" << _time[i];
+        total += _time[i];
+    }
+    out << ",\"total\":" << total << "}";
+
+    out << ",\"counters\":{";
+    for (int i = 0; i < COUNTER_NUM; i++)
+        out << (i > 0 ? "," : "") << "\"" << counterName[i] << "\":" << _counter[i];
+    out << "}";
+
+    // net size classes 2, 3-4, 5-8, ..., > 128
+    out << ",\"gain_updates_by_net_size\":{";
+    for (int i = 0; i < SIZE_CLASS_NUM; i++)
+    {
+        out << (i > 0 ? "," : "") << "\"";
+        if (i == 0)
+            out << 2;
+        else if (i == SIZE_CLASS_NUM - 1)
+            out << ">" << (1 << i);
+        else
+            out << (1 << i) + 1 << "-" << (2 << i);
+        out << "\":" << _gainUpdate[i];
+    }
+    out << "}";
+
+    out << ",\"passes\":[";
+    for (size_t i = 0; i < _passes.size(); i++)
+    {
+        const Pass &pass = _passes[i];
+        out << (i > 0 ? "," : "") << "{\"gain\":" << pass.gain << ",\"moves\":" << pass.moveNum
+            << ",\"best_prefix\":" << pass.bestMoveNum << ",\"cutsize\":" << pass.cutSize
+            << ",\"time\":" << pass.time << "}";
+    }
+    out << "]}";
+}
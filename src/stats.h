@@ -0,0 +1,119 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+using namespace std;
+
+// Run statistics of the FM engine: event counters, per-phase times and one
+// record per FM pass. The counters and timers on the hot path are updated
+// through the STATS_* macros below, which compile to nothing when built
+// with -DFM_NO_STATS (make STATS=0).
+class Stats
+{
+public:
+    enum Counter
+    {
+        SELECT,         // max gain cell selections
+        BUCKET_SCAN,    // bitmap words scanned to find the next max gain bucket
+        BALANCE_REJECT, // bucket heads rejected by the balance constraint
+        GAIN_UPDATE,    // gain changes made by moves
+        LOCKED_UPDATE,  // gain changes of locked cells, which skip the buckets
+        UNDO_MOVE,      // moves undone from the gain log
+        RECOUNT,        // rollbacks done by recounting from scratch
+        COUNTER_NUM
+    };
+    enum Phase
+    {
+        PARSE,    // reading the input
+        INITIAL,  // initial partition, for multilevel also coarsening and coarse levels
+        COUNT,    // counting part counts, cutsize and gains before the passes
+        PASS,     // moves of the FM passes
+        ROLLBACK, // rolling back the moves after the best prefix
+        OUTPUT,   // writing the result
+        PHASE_NUM
+    };
+    struct Pass
+    {
+        int gain;        // max partial sum
+        int moveNum;     // moves made
+        int bestMoveNum; // moves kept, the best prefix
+        int cutSize;     // cutsize after the pass
+        double time;     // seconds
+    };
+    static const int SIZE_CLASS_NUM = 8; // net sizes 2, 3-4, 5-8, ..., 65-128, > 128
+
+    // constructor and destructor
+    Stats() { clear(); }
+    ~Stats() {}
+
+    // basic access methods
+    long long getCounter(const Counter counter) const { return _counter[counter]; }
+    double getTime(const Phase phase) const { return _time[phase]; }
+    const vector<Pass> &getPasses() const { return _passes; }
+    static bool isEnabled();
+
+    // set functions
+    void setTime(const Phase phase, const double seconds) { _time[phase] = seconds; }
+
+    // modify methods
+    void inc(const Counter counter, const long long n = 1) { _counter[counter] += n; }
+    void incGainUpdate(const int netSize)
+    {
+        ++_counter[GAIN_UPDATE];
+        ++_gainUpdate[getSizeClass(netSize)];
+    }
+    void addTime(const Phase phase, const double seconds) { _time[phase] += seconds; }
+    void addPass(const Pass &pass) { _passes.push_back(pass); }
+    void merge(const Stats &stats); // add counters and times, passes stay
+    void clear();
+
+    // member functions about reporting
+    void writeJson(ostream &out) const;
+
+private:
+    long long _counter[COUNTER_NUM];       // event counts
+    long long _gainUpdate[SIZE_CLASS_NUM]; // gain changes by net size class
+    double _time[PHASE_NUM];               // seconds per phase
+    vector<Pass> _passes;                  // FM passes of the finest level, in order
+
+    static int getSizeClass(const int netSize)
+    {
+        int sizeClass = 0;
+        while (sizeClass < SIZE_CLASS_NUM - 1 && netSize > (2 << sizeClass))
+            ++sizeClass;
+        return sizeClass;
+    }
+};
+
+// Adds the lifetime of the timer to a phase
+class ScopedTimer
+{
+public:
+    ScopedTimer(Stats &stats, const Stats::Phase phase)
+        : _stats(stats), _phase(phase), _start(chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        _stats.addTime(_phase, chrono::duration<double>(chrono::steady_clock::now() - _start).count());
+    }
+
+private:
+    Stats &_stats;
+    Stats::Phase _phase;
+    chrono::steady_clock::time_point _start;
+};
+
+#ifdef FM_NO_STATS
+#define STATS_INC(stats, counter, n) ((void)0)
+#define STATS_GAIN_UPDATE(stats, netSize) ((void)0)
+#define STATS_TIMER(stats, phase) ((void)0)
+#else
+#define STATS_CONCAT2(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT2(a, b)
+#define STATS_INC(stats, counter, n) (stats).inc(Stats::counter, n)
+#define STATS_GAIN_UPDATE(stats, netSize) (stats).incGainUpdate(netSize)
+#define STATS_TIMER(stats, phase) ScopedTimer STATS_CONCAT(statsTimer, __LINE__)(stats, Stats::phase)
+#endif
+
+#endif // STATS_H
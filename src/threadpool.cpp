@@ -0,0 +1,72 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+using namespace std;
+
+ThreadPool::ThreadPool(const int threadNum) : _pending(0), _stop(false)
+{
+    for (int i = 0; i < max(threadNum, 1); i++)
+    {
+        _workers.push_back(thread(&ThreadPool::worker, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _taskCond.notify_all();
+    for (size_t i = 0; i < _workers.size(); ++i)
+    {
+        _workers[i].join();
+    }
+}
+
+int ThreadPool::getDefaultThreadNum()
+{
+    return max((int)thread::hardware_concurrency(), 1);
+}
+
+void ThreadPool::submit(const function<void()> &task)
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _tasks.push(task);
+        ++_pending;
+    }
+    _taskCond.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    unique_lock<mutex> lock(_mutex);
+    while (_pending > 0)
+        _doneCond.wait(lock);
+}
+
+void ThreadPool::worker()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(_mutex);
+            while (!_stop && _tasks.empty())
+                _taskCond.wait(lock);
+            if (_tasks.empty())
+                return;
+            task = _tasks.front();
+            _tasks.pop();
+        }
+        task();
+        {
+            lock_guard<mutex> lock(_mutex);
+            if (--_pending == 0)
+                _doneCond.notify_all();
+        }
+    }
+}
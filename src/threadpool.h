@@ -0,0 +1,43 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Fixed set of worker threads running submitted tasks in FIFO order
+class ThreadPool
+{
+public:
+    // constructor and destructor
+    ThreadPool(const int threadNum);
+    ~ThreadPool();
+
+    // basic access methods
+    int getThreadNum() const { return (int)_workers.size(); }
+    static int getDefaultThreadNum();
+
+    // modify methods
+    void submit(const function<void()> &task);
+    void wait(); // block until every submitted task has finished
+
+private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    vector<thread> _workers;         // worker threads
+    queue<function<void()> > _tasks; // tasks not started yet
+    mutex _mutex;                    // guards _tasks, _pending and _stop
+    condition_variable _taskCond;    // signalled when a task is queued or on stop
+    condition_variable _doneCond;    // signalled when _pending drops to 0
+    int _pending;                    // tasks queued or running
+    bool _stop;                      // workers should exit
+
+    void worker();
+};
+
+#endif // THREADPOOL_H
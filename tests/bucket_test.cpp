@@ -0,0 +1,109 @@
+#include "../src/bucket.h"
+#include "test.h"
+#include <cstdlib>
+#include <set>
+#include <vector>
+using namespace std;
+
+static const int NO_GAIN = 1 << 30;  // gain of a node not in the list
+static const int STEP_NUM = 200000; // random operations per case
+
+// random inserts, removes and gain updates checked against a multiset of
+// the gains in the list, which gives the expected size and max gain
+static void checkRandom(const int maxGain, const int nodeNum, const bool sparse, const unsigned seed)
+{
+    srand(seed);
+    BucketList bList;
+    bList.init(maxGain, nodeNum);
+    CHECK(bList.isSparse() == sparse);
+    CHECK(bList.getMaxGainNode() == NULL);
+
+    vector<Node> node;
+    for (int i = 0; i < nodeNum; i++)
+    {
+        node.push_back(Node(i));
+    }
+    vector<int> gain(nodeNum, NO_GAIN);
+    multiset<int> inList;
+    for (int step = 0; step < STEP_NUM; step++)
+    {
+        const int i = rand() % nodeNum;
+        // gains cluster at the ends of the range half of the time, so the
+        // bitmap scan crosses empty summary words
+        const int newGain = (rand() % 2) ? rand() % (2 * maxGain + 1) - maxGain
+                                         : ((rand() % 2) ? maxGain : -maxGain) - (rand() % 3) * ((rand() % 2) ? -1 : 1);
+        if (newGain < -maxGain || newGain > maxGain)
+            continue;
+        if (gain[i] == NO_GAIN)
+        {
+            bList.insert(&node[i], newGain);
+            gain[i] = newGain;
+            inList.insert(newGain);
+        }
+        else if (rand() % 3 == 0)
+        {
+            bList.remove(&node[i], gain[i]);
+            inList.erase(inList.find(gain[i]));
+            gain[i] = NO_GAIN;
+        }
+        else
+        {
+            bList.update(&node[i], gain[i], newGain);
+            inList.erase(inList.find(gain[i]));
+            gain[i] = newGain;
+            inList.insert(newGain);
+        }
+
+        CHECK(bList.getSize() == (int)inList.size());
+        Node *best = bList.getMaxGainNode();
+        CHECK((best == NULL) == inList.empty());
+        if (best != NULL)
+            CHECK(gain[best->getId()] == *inList.rbegin());
+    }
+
+    // getNextNode walks every node once, in non-increasing gain order
+    int walked = 0;
+    int last = maxGain;
+    for (Node *node = bList.getMaxGainNode(); node != NULL; node = bList.getNextNode(node, gain[node->getId()]))
+    {
+        CHECK(gain[node->getId()] <= last);
+        last = gain[node->getId()];
+        ++walked;
+    }
+    CHECK(walked == (int)inList.size());
+
+    // drain from the top, the gains come out in non-increasing order
+    last = maxGain;
+    for (Node *best = bList.getMaxGainNode(); best != NULL; best = bList.getMaxGainNode())
+    {
+        const int i = best->getId();
+        CHECK(gain[i] <= last);
+        last = gain[i];
+        bList.remove(best, gain[i]);
+        gain[i] = NO_GAIN;
+    }
+    CHECK(bList.empty());
+}
+
+int main()
+{
+    checkRandom(5, 40, false, 1);          // unit weights, a few buckets
+    checkRandom(20000, 300, false, 2);     // dense, the summary bitmap spans several words
+    checkRandom(2000000, 300, true, 3);    // range above 65536 with few nodes: ordered map
+    checkRandom(40000, 50000, false, 4);   // range above 65536 but dense for many nodes
+
+    // insert puts a node at the front of its bucket, the head is the last in
+    BucketList bList;
+    bList.init(3, 4);
+    Node a(0), b(1), c(2);
+    bList.insert(&a, 2);
+    bList.insert(&b, 2);
+    bList.insert(&c, -3);
+    CHECK(bList.getMaxGainNode() == &b);
+    bList.remove(&b, 2);
+    CHECK(bList.getMaxGainNode() == &a);
+    bList.update(&a, 2, -3);
+    CHECK(bList.getMaxGainNode() == &a);
+    CHECK(bList.getSize() == 2);
+    return testResult("bucket");
+}
@@ -0,0 +1,38 @@
+#ifndef CIRCUIT_H
+#define CIRCUIT_H
+
+#include "../src/libfm.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+// Random circuit for the tests, nets of 2 to 6 distinct pins. Cell weights
+// are in [1, maxCellWeight] and net weights in [1, maxNetWeight]; with
+// both 1 the circuit is unweighted.
+static inline shared_ptr<const Hypergraph> randomGraph(const int cellNum, const int netNum, const int maxCellWeight,
+                                                       const int maxNetWeight, const unsigned seed)
+{
+    srand(seed);
+    vector<int> netOffset(1, 0), netPins, cellWeight, netWeight;
+    for (int i = 0; i < netNum; i++)
+    {
+        const int size = 2 + rand() % 5;
+        while ((int)netPins.size() < netOffset.back() + size)
+        {
+            const int cellId = rand() % cellNum;
+            if (find(netPins.begin() + netOffset.back(), netPins.end(), cellId) == netPins.end())
+                netPins.push_back(cellId);
+        }
+        netOffset.push_back(netPins.size());
+        if (maxNetWeight > 1)
+            netWeight.push_back(1 + rand() % maxNetWeight);
+    }
+    for (int i = 0; maxCellWeight > 1 && i < cellNum; i++)
+    {
+        cellWeight.push_back(1 + rand() % maxCellWeight);
+    }
+    return buildHypergraph(cellNum, netOffset, netPins, cellWeight, netWeight);
+}
+
+#endif // CIRCUIT_H
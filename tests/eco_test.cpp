@@ -0,0 +1,177 @@
+#include "../src/eco.h"
+#include "test.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+// a fresh file name under /tmp, removed at the end of main()
+static string tempName(vector<string> &names)
+{
+    char name[] = "/tmp/fm_eco_XXXXXX";
+    const int fd = mkstemp(name);
+    CHECK(fd >= 0);
+    close(fd);
+    names.push_back(name);
+    return name;
+}
+
+// nets of 2 to 6 distinct pins over cells c0 .. c<cellNum - 1>
+static vector<vector<string> > randomNets(const int cellNum, const int netNum)
+{
+    vector<vector<string> > nets(netNum);
+    for (int i = 0; i < netNum; i++)
+    {
+        const int size = 2 + rand() % 5;
+        while ((int)nets[i].size() < size)
+        {
+            const string cell = "c" + to_string(rand() % cellNum);
+            if (find(nets[i].begin(), nets[i].end(), cell) == nets[i].end())
+                nets[i].push_back(cell);
+        }
+    }
+    return nets;
+}
+
+// nets with an empty pin list are left out, so their names are removed
+static void writeNetlist(const string &fileName, const vector<vector<string> > &nets)
+{
+    fstream file(fileName.c_str(), ios::out);
+    file << "0.1" << endl;
+    for (size_t i = 0; i < nets.size(); i++)
+    {
+        if (nets[i].empty())
+            continue;
+        file << "NET n" << i;
+        for (size_t j = 0; j < nets[i].size(); j++)
+        {
+            file << " " << nets[i][j];
+        }
+        file << " ;" << endl;
+    }
+}
+
+static void partitionFile(const string &netlistName, const string &resultName)
+{
+    Partitioner partitioner;
+    partitioner.setVerbose(false);
+    CHECK(partitioner.parseFile(netlistName.c_str()));
+    partitioner.partition();
+    fstream file(resultName.c_str(), ios::out);
+    CHECK(partitioner.writeResult(file));
+}
+
+// summed weight of the nets with pins on both sides, from scratch
+static int cutOf(const Partitioner &partitioner)
+{
+    const Hypergraph &graph = partitioner.getGraph();
+    int cutSize = 0;
+    for (int i = 0; i < graph.getNetNum(); i++)
+    {
+        const IdSpan pins = graph.getCellList(i);
+        for (int k = 1; k < pins.size(); k++)
+        {
+            if (partitioner.getPart(pins[k]) != partitioner.getPart(pins[0]))
+            {
+                cutSize += graph.getNetWeight(i);
+                break;
+            }
+        }
+    }
+    return cutSize;
+}
+
+int main()
+{
+    srand(1);
+    vector<string> names;
+    const int cellNum = 500;
+    vector<vector<string> > nets = randomNets(cellNum, 900);
+    const string netlistName = tempName(names);
+    const string resultName = tempName(names);
+    writeNetlist(netlistName, nets);
+    partitionFile(netlistName, resultName);
+
+    // the same netlist: nothing changed, every cell keeps its side
+    {
+        Partitioner previous;
+        previous.setVerbose(false);
+        CHECK(previous.parseFile(netlistName.c_str()));
+        fstream file(resultName.c_str(), ios::in);
+        vector<char> listed;
+        int cutSize;
+        CHECK(previous.readResult(file, listed, &cutSize) == 0);
+
+        Partitioner partitioner;
+        partitioner.setVerbose(false);
+        CHECK(partitioner.parseFile(netlistName.c_str()));
+        Eco eco(partitioner);
+        CHECK(eco.readNetlist(netlistName.c_str()));
+        CHECK(eco.readResult(resultName.c_str()));
+        CHECK(eco.partition());
+        CHECK(eco.getNewNum() == 0 && eco.getRemovedNum() == 0 && eco.getChangedNum() == 0);
+        CHECK(partitioner.getCutSize() == cutSize);
+        for (int i = 0; i < partitioner.getCellNum(); i++)
+        {
+            CHECK(partitioner.getPart(i) == previous.getPart(i));
+        }
+    }
+
+    // remove 5 nets, swap a pin of 5 others, add 5 nets with a new cell each
+    vector<vector<string> > edited = nets;
+    for (int i = 0; i < 5; i++)
+    {
+        edited[10 * i].clear();
+        vector<string> &net = edited[10 * i + 5];
+        const string cell = "c" + to_string(rand() % cellNum);
+        if (find(net.begin(), net.end(), cell) == net.end())
+            net[0] = cell;
+        else
+            net.pop_back();
+        vector<string> added;
+        added.push_back("x" + to_string(i));
+        added.push_back("c" + to_string(i));
+        added.push_back("c" + to_string(cellNum - 1 - i));
+        edited.push_back(added);
+    }
+    const string editedName = tempName(names);
+    const string ecoName = tempName(names);
+    writeNetlist(editedName, edited);
+    {
+        Partitioner partitioner;
+        partitioner.setVerbose(false);
+        CHECK(partitioner.parseFile(editedName.c_str()));
+        Eco eco(partitioner);
+        CHECK(eco.readNetlist(netlistName.c_str()));
+        CHECK(eco.readResult(resultName.c_str()));
+        CHECK(eco.partition());
+        CHECK(eco.getNewNum() == 5);
+        CHECK(eco.getKeptNum() + eco.getRemovedNum() <= cellNum);
+        CHECK(eco.getChangedNum() == 15);
+        CHECK(partitioner.isBalanced());
+        // the incremental cutsize matches a recount of the sides
+        CHECK(partitioner.getCutSize() == cutOf(partitioner));
+        fstream file(ecoName.c_str(), ios::out);
+        CHECK(partitioner.writeResult(file));
+    }
+
+    // a result must list exactly the cells of the netlist it is read with
+    {
+        Partitioner partitioner;
+        partitioner.setVerbose(false);
+        CHECK(partitioner.parseFile(netlistName.c_str()));
+        Eco eco(partitioner);
+        CHECK(eco.readNetlist(netlistName.c_str()));
+        CHECK(!eco.readResult(ecoName.c_str()));
+    }
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        remove(names[i].c_str());
+    }
+    return testResult("eco");
+}
@@ -0,0 +1,86 @@
+#include "../src/libfm.h"
+#include "circuit.h"
+#include "test.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using namespace std;
+
+// random netlist file of cellNum cells, removed by the caller
+static string writeNetlist(const int cellNum, const int netNum, const unsigned seed)
+{
+    char name[] = "/tmp/fm_engine_XXXXXX";
+    const int fd = mkstemp(name);
+    CHECK(fd >= 0);
+    close(fd);
+    srand(seed);
+    fstream file(name, ios::out);
+    file << "0.1" << endl;
+    for (int i = 0; i < netNum; i++)
+    {
+        file << "NET n" << i;
+        for (int size = 2 + rand() % 5; size > 0; size--)
+        {
+            file << " c" << rand() % cellNum;
+        }
+        file << " ;" << endl;
+    }
+    return name;
+}
+
+static void checkSame(const FmResult &a, const FmResult &b)
+{
+    CHECK(a.cutSize == b.cutSize);
+    CHECK(a.partSize[0] == b.partSize[0] && a.partSize[1] == b.partSize[1]);
+    CHECK(a.part == b.part);
+}
+
+int main()
+{
+    FmOptions options;
+
+    // a reused engine gives what a fresh one gives, for a larger circuit
+    // followed by a smaller one and back
+    const string large = writeNetlist(2000, 3000, 1);
+    const string small = writeNetlist(300, 500, 2);
+    FmEngine engine;
+    FmResult result[3];
+    string error;
+    CHECK(engine.partitionFile(large.c_str(), NULL, options, result[0], error));
+    CHECK(engine.partitionFile(small.c_str(), NULL, options, result[1], error));
+    CHECK(engine.partitionFile(large.c_str(), NULL, options, result[2], error));
+    CHECK(result[1].part.size() < result[0].part.size());
+    checkSame(result[0], result[2]);
+    {
+        FmEngine fresh;
+        FmResult freshResult;
+        CHECK(fresh.partitionFile(small.c_str(), NULL, options, freshResult, error));
+        checkSame(result[1], freshResult);
+    }
+    CHECK(!engine.partitionFile("/nonexistent/input.dat", NULL, options, result[0], error));
+    remove(large.c_str());
+    remove(small.c_str());
+
+    // pinned cells keep their side; a fixed vector of the wrong size is an
+    // error and leaves the result alone
+    shared_ptr<const Hypergraph> graph = randomGraph(400, 700, 1, 1, 3);
+    vector<signed char> fixed(graph->getCellNum(), -1);
+    for (int i = 0; i < 40; i++)
+    {
+        fixed[i] = i % 2;
+    }
+    FmResult pinned;
+    CHECK(engine.partition(graph, options, pinned, &fixed));
+    for (int i = 0; i < 40; i++)
+    {
+        CHECK(pinned.part[i] == i % 2);
+    }
+    CHECK(pinned.balanced);
+    fixed.pop_back();
+    FmResult rejected;
+    CHECK(!engine.partition(graph, options, rejected, &fixed));
+    CHECK(rejected.part.empty());
+    return testResult("engine");
+}
@@ -0,0 +1,62 @@
+#include "../src/evaluator.h"
+#include "../src/partitioner.h"
+#include "circuit.h"
+#include "test.h"
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+// candidateNum random partitions scored in one sweep must match the
+// cutsize and size of side B the partitioner counts for each of them
+static void checkCandidates(shared_ptr<const Hypergraph> graph, const int candidateNum)
+{
+    const int cellNum = graph->getCellNum();
+    vector<uint64_t> bits((size_t)cellNum * CutEvaluator::getWordNum(candidateNum), 0);
+    for (int i = 0; i < cellNum; i++)
+    {
+        for (int c = 0; c < candidateNum; c++)
+        {
+            // some candidates leave a side empty or nearly so
+            const int bias = (c % 7 == 0) ? 0 : (c % 7 == 1) ? 100 : 50;
+            CutEvaluator::setPart(bits, candidateNum, i, c, rand() % 100 < bias);
+        }
+    }
+    CutEvaluator evaluator(*graph);
+    vector<long long> cutSize, partSizeB;
+    evaluator.countCutsize(bits, candidateNum, cutSize);
+    evaluator.countPartsize(bits, candidateNum, partSizeB);
+    CHECK((int)cutSize.size() == candidateNum);
+    CHECK((int)partSizeB.size() == candidateNum);
+
+    Partitioner partitioner(graph, 0.1);
+    partitioner.setVerbose(false);
+    for (int c = 0; c < candidateNum && c < (int)cutSize.size() && c < (int)partSizeB.size(); c++)
+    {
+        for (int i = 0; i < cellNum; i++)
+        {
+            partitioner.setPart(i, CutEvaluator::getPart(bits, candidateNum, i, c));
+        }
+        partitioner.countNetPartCount();
+        partitioner.countPartsize();
+        partitioner.countCutsize();
+        CHECK(cutSize[c] == partitioner.getCutSize());
+        CHECK(partSizeB[c] == partitioner.getPartSize(1));
+    }
+}
+
+int main()
+{
+    // unit weights take the bit-sliced counters, weights the scalar adds;
+    // candidate counts straddle the 64-bit words
+    shared_ptr<const Hypergraph> unit = randomGraph(500, 900, 1, 1, 1);
+    shared_ptr<const Hypergraph> weighted = randomGraph(500, 900, 7, 40, 2);
+    shared_ptr<const Hypergraph> mixed = randomGraph(500, 900, 1, 3, 3);
+    const int candidateNums[] = {1, 63, 64, 65, 130, 200};
+    for (size_t i = 0; i < sizeof(candidateNums) / sizeof(candidateNums[0]); i++)
+    {
+        checkCandidates(unit, candidateNums[i]);
+        checkCandidates(weighted, candidateNums[i]);
+        checkCandidates(mixed, candidateNums[i]);
+    }
+    return testResult("evaluator");
+}
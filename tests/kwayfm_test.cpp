@@ -0,0 +1,94 @@
+#include "../src/kwayfm.h"
+#include "circuit.h"
+#include "test.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+// objective of block from scratch: nets spanning more than one block for
+// the cut, the summed (blocks spanned - 1) for the connectivity
+static int objectiveOf(const Hypergraph &graph, const int k, const vector<int> &block,
+                       const KWayRefiner::Objective objective)
+{
+    int value = 0;
+    vector<char> seen(k);
+    for (int i = 0; i < graph.getNetNum(); i++)
+    {
+        const IdSpan pins = graph.getCellList(i);
+        seen.assign(k, 0);
+        int lambda = 0;
+        for (const int *pin = pins.begin(); pin != pins.end(); ++pin)
+        {
+            if (!seen[block[*pin]])
+                ++lambda;
+            seen[block[*pin]] = 1;
+        }
+        if (lambda > 1)
+            value += graph.getNetWeight(i) * ((objective == KWayRefiner::CUT_NET) ? 1 : lambda - 1);
+    }
+    return value;
+}
+
+// single passes from a greedy balanced start: the gain each pass reports
+// is the drop of the objective recounted from the blocks, and the blocks
+// stay within the bounds
+static void checkPasses(shared_ptr<const Hypergraph> graph, const int k, const KWayRefiner::Objective objective)
+{
+    const double bFactor = 0.1;
+    const int cellNum = graph->getCellNum();
+    vector<int> block(cellNum), weight(k, 0);
+    for (int i = 0; i < cellNum; i++)
+    {
+        int lightest = rand() % k;
+        for (int b = 0; b < k; b++)
+        {
+            if (weight[b] < weight[lightest])
+                lightest = b;
+        }
+        block[i] = lightest;
+        weight[lightest] += graph->getCellWeight(i);
+    }
+
+    KWayRefiner refiner(*graph, k, bFactor, block);
+    refiner.setObjective(objective);
+    refiner.setMaxPass(1);
+    int value = objectiveOf(*graph, k, block, objective);
+    for (int pass = 0; pass < 8; pass++)
+    {
+        const int gain = refiner.refine();
+        const int recount = objectiveOf(*graph, k, block, objective);
+        CHECK(gain >= 0);
+        CHECK(value - gain == recount);
+        CHECK(refiner.getObjectiveValue() == recount);
+        CHECK(refiner.countObjective() == recount);
+        value = recount;
+    }
+
+    const double avg = (double)graph->getTotalWeight() / k;
+    weight.assign(k, 0);
+    for (int i = 0; i < cellNum; i++)
+    {
+        weight[block[i]] += graph->getCellWeight(i);
+    }
+    for (int b = 0; b < k; b++)
+    {
+        CHECK(weight[b] >= ceil((1 - bFactor) * avg));
+        CHECK(weight[b] <= floor((1 + bFactor) * avg));
+    }
+}
+
+int main()
+{
+    shared_ptr<const Hypergraph> unit = randomGraph(600, 1000, 1, 1, 1);
+    shared_ptr<const Hypergraph> weighted = randomGraph(600, 1000, 5, 30, 2);
+    const int ks[] = {2, 3, 4, 8};
+    for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); i++)
+    {
+        checkPasses(unit, ks[i], KWayRefiner::CUT_NET);
+        checkPasses(unit, ks[i], KWayRefiner::CONNECTIVITY);
+        checkPasses(weighted, ks[i], KWayRefiner::CUT_NET);
+        checkPasses(weighted, ks[i], KWayRefiner::CONNECTIVITY);
+    }
+    return testResult("kwayfm");
+}
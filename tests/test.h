@@ -0,0 +1,27 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <iostream>
+using namespace std;
+
+// Minimal checks for the tests under tests/: a failed CHECK prints its
+// location and keeps going, testResult() reports and gives the exit code.
+static int testFailNum = 0;
+
+#define CHECK(cond)                                                                \
+    do                                                                             \
+    {                                                                              \
+        if (!(cond))                                                               \
+        {                                                                          \
+            cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << endl; \
+            ++testFailNum;                                                         \
+        }                                                                          \
+    } while (0)
+
+static inline int testResult(const char *name)
+{
+    cout << (testFailNum == 0 ? "ok   " : "FAIL ") << name << endl;
+    return (testFailNum == 0) ? 0 : 1;
+}
+
+#endif // TEST_H
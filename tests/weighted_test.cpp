@@ -0,0 +1,159 @@
+#include "../src/partitioner.h"
+#include "circuit.h"
+#include "test.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+// summed weight of the nets with pins on both sides, from scratch
+static int cutOf(const Hypergraph &graph, const vector<char> &part)
+{
+    int cutSize = 0;
+    for (int i = 0; i < graph.getNetNum(); i++)
+    {
+        const IdSpan pins = graph.getCellList(i);
+        bool side[2] = {false, false};
+        for (const int *pin = pins.begin(); pin != pins.end(); ++pin)
+        {
+            side[(int)part[*pin]] = true;
+        }
+        if (side[0] && side[1])
+            cutSize += graph.getNetWeight(i);
+    }
+    return cutSize;
+}
+
+static vector<char> sidesOf(const Partitioner &partitioner)
+{
+    vector<char> part(partitioner.getCellNum());
+    for (int i = 0; i < partitioner.getCellNum(); i++)
+    {
+        part[i] = partitioner.getPart(i);
+    }
+    return part;
+}
+
+// counted sizes, cutsize and gains match a recount from the sides
+static void checkCounts(const Partitioner &partitioner)
+{
+    const Hypergraph &graph = partitioner.getGraph();
+    vector<char> part = sidesOf(partitioner);
+    int partSize[2] = {0, 0};
+    for (int i = 0; i < graph.getCellNum(); i++)
+    {
+        partSize[(int)part[i]] += graph.getCellWeight(i);
+    }
+    CHECK(partitioner.getPartSize(0) == partSize[0]);
+    CHECK(partitioner.getPartSize(1) == partSize[1]);
+    const int cutSize = cutOf(graph, part);
+    CHECK(partitioner.getCutSize() == cutSize);
+    for (int i = 0; i < graph.getCellNum(); i++)
+    {
+        part[i] = !part[i];
+        CHECK(partitioner.getGain(i) == cutSize - cutOf(graph, part));
+        part[i] = !part[i];
+    }
+}
+
+static void checkBalanced(const Partitioner &partitioner, const double bFactor)
+{
+    const double total = partitioner.getGraph().getTotalWeight();
+    for (int side = 0; side < 2; side++)
+    {
+        CHECK(partitioner.getPartSize(side) >= (1 - bFactor) / 2 * total);
+        CHECK(partitioner.getPartSize(side) <= (1 + bFactor) / 2 * total);
+    }
+}
+
+int main()
+{
+    const double bFactor = 0.1;
+    shared_ptr<const Hypergraph> graph = randomGraph(300, 500, 9, 50, 1);
+    CHECK(graph);
+
+    // weighted gains of a random partition
+    Partitioner partitioner(graph, bFactor);
+    partitioner.setVerbose(false);
+    for (int i = 0; i < graph->getCellNum(); i++)
+    {
+        partitioner.setPart(i, rand() % 2);
+    }
+    partitioner.countNetPartCount();
+    partitioner.countPartsize();
+    partitioner.countCutsize();
+    partitioner.countGain();
+    checkCounts(partitioner);
+
+    // the integer bounds admit exactly the sizes within the real bounds
+    partitioner.countBalanceBound();
+    const double total = graph->getTotalWeight();
+    CHECK(partitioner.getLowerBound() == (int)ceil((1 - bFactor) / 2 * total));
+    CHECK(partitioner.getUpperBound() == (int)floor((1 + bFactor) / 2 * total));
+
+    // everything on one side: rebalance moves weight over, then FM keeps it
+    for (int i = 0; i < graph->getCellNum(); i++)
+    {
+        partitioner.setPart(i, 0);
+    }
+    partitioner.countNetPartCount();
+    partitioner.countPartsize();
+    partitioner.countCutsize();
+    partitioner.countGain();
+    CHECK(!partitioner.isBalanced());
+    CHECK(partitioner.rebalance());
+    checkBalanced(partitioner, bFactor);
+    checkCounts(partitioner);
+
+    // a heavy head whose move would break the bound must not block its
+    // side: only side A is free, its best cell weighs 10 and may not move,
+    // the next one (gain 1) may
+    {
+        // cell 0 (weight 10) and 1-5 on A, 6-20 on B; bounds [14, 16] of 30
+        vector<int> netOffset, netPins, cellWeight(21, 1), netWeight;
+        const int pins[][2] = {{0, 6}, {0, 7}, {0, 8}, {1, 9}, {2, 3}, {4, 5}, {6, 10}};
+        netOffset.push_back(0);
+        for (size_t i = 0; i < sizeof(pins) / sizeof(pins[0]); i++)
+        {
+            netPins.push_back(pins[i][0]);
+            netPins.push_back(pins[i][1]);
+            netOffset.push_back(netPins.size());
+        }
+        cellWeight[0] = 10;
+        shared_ptr<const Hypergraph> small = buildHypergraph(21, netOffset, netPins, cellWeight, netWeight);
+        CHECK(small);
+        Partitioner region(small, bFactor);
+        region.setVerbose(false);
+        vector<int> sideA;
+        for (int i = 0; i < 21; i++)
+        {
+            region.setPart(i, i > 5);
+            if (i <= 5)
+                sideA.push_back(i);
+        }
+        region.countNetPartCount();
+        region.countPartsize();
+        region.countCutsize();
+        region.countGain();
+        region.countBalanceBound();
+        region.lockAll();
+        CHECK(region.getCutSize() == 4);
+        CHECK(region.refineRegion(sideA) == 1);
+        CHECK(region.getCutSize() == 3);
+        CHECK(region.getPart(0) == 0);
+        CHECK(region.getPart(1) == 1);
+        checkBalanced(region, bFactor);
+    }
+
+    // full runs end balanced with a consistent weighted cutsize
+    for (unsigned seed = 2; seed < 6; seed++)
+    {
+        graph = randomGraph(400, 700, 1 + seed * 3, 1 + seed * 20, seed);
+        Partitioner run(graph, bFactor);
+        run.setVerbose(false);
+        run.partition();
+        checkBalanced(run, bFactor);
+        CHECK(run.getCutSize() == cutOf(*graph, sidesOf(run)));
+    }
+    return testResult("weighted");
+}